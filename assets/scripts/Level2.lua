@@ -90,6 +90,34 @@ Level = {
         scale = 2.0
     },
 
+    ----------------------------------------------------
+    -- table to define prefabs, the components shared by
+    -- many entities (an entity sets prefab = "name" and
+    -- lists only the components it changes)
+    ----------------------------------------------------
+    prefabs = {
+        runway = {
+            components = {
+                sprite = {
+                    texture_asset_id = "runway-texture",
+                    width = 21,
+                    height = 191,
+                    z_index = 1
+                }
+            }
+        },
+        obstacle = {
+            components = {
+                sprite = {
+                    texture_asset_id = "obstacles7-texture",
+                    width = 16,
+                    height = 16,
+                    z_index = 2
+                }
+            }
+        }
+    },
+
     ----------------------------------------------------
     -- table to define entities and their components
     ----------------------------------------------------
@@ -214,113 +242,78 @@ Level = {
         },
         {
             -- Runway
+            prefab = "runway",
             components = {
                 transform = {
                     position = { x = 470, y = 385 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "runway-texture",
-                    width = 21,
-                    height = 191,
-                    z_index = 1
                 }
             }
         },
         {
             -- Runway
+            prefab = "runway",
             components = {
                 transform = {
                     position = { x = 800, y = 1400 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 90.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "runway-texture",
-                    width = 21,
-                    height = 191,
-                    z_index = 1
                 }
             }
         },
         {
             -- Runway
+            prefab = "runway",
             components = {
                 transform = {
                     position = { x = 800, y = 1500 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 90.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "runway-texture",
-                    width = 21,
-                    height = 191,
-                    z_index = 1
                 }
             }
         },
         {
             -- Runway
+            prefab = "runway",
             components = {
                 transform = {
                     position = { x = 800, y = 1600 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 90.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "runway-texture",
-                    width = 21,
-                    height = 191,
-                    z_index = 1
                 }
             }
         },
         {
             -- Runway
+            prefab = "runway",
             components = {
                 transform = {
                     position = { x = 1300, y = 1400 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 90.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "runway-texture",
-                    width = 21,
-                    height = 191,
-                    z_index = 1
                 }
             }
         },
         {
             -- Runway
+            prefab = "runway",
             components = {
                 transform = {
                     position = { x = 1300, y = 1500 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 90.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "runway-texture",
-                    width = 21,
-                    height = 191,
-                    z_index = 1
                 }
             }
         },
         {
             -- Runway
+            prefab = "runway",
             components = {
                 transform = {
                     position = { x = 1300, y = 1600 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 90.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "runway-texture",
-                    width = 21,
-                    height = 191,
-                    z_index = 1
                 }
             }
         },
@@ -1503,466 +1496,321 @@ Level = {
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 400, y = 500 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 1350, y = 400 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 1920, y = 1700 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 900, y = 800 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 920, y = 800 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 940, y = 800 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 960, y = 800 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 980, y = 800 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 1000, y = 800 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 1020, y = 800 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 1040, y = 800 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 900, y = 710 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 920, y = 710 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 940, y = 710 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 960, y = 710 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 980, y = 710 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 1000, y = 710 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 1020, y = 710 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 1040, y = 710 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 900, y = 725 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 900, y = 740 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 900, y = 755 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 900, y = 770 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 900, y = 785 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 1040, y = 725 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 1040, y = 740 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 1040, y = 755 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 1040, y = 770 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
             -- Obstacle
+            prefab = "obstacle",
             components = {
                 transform = {
                     position = { x = 1040, y = 785 },
                     scale = { x = 1.0, y = 1.0 },
                     rotation = 0.0, -- degrees
-                },
-                sprite = {
-                    texture_asset_id = "obstacles7-texture",
-                    width = 16,
-                    height = 16,
-                    z_index = 2
-                },
+                }
             }
         },
         {
@@ -28,6 +28,12 @@ void AssetStore::FreeFont(TTF_Font* font) {
 }
 
 void AssetStore::AddTexture(SDL_Renderer* renderer, const std::string& assetId, const std::string& filePath){
+    // A headless game has no renderer, only the id of the texture is kept
+    if (!renderer) {
+        m_textures.emplace(assetId, nullptr);
+        return;
+    }
+
     SDL_Surface* surface = IMG_Load(filePath.c_str());
     SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
     SDL_FreeSurface(surface);
@@ -41,7 +47,7 @@ void AssetStore::AddTexture(SDL_Renderer* renderer, const std::string& assetId,
 SDL_Texture* AssetStore::GetTexture(const std::string& assetId){
     return m_textures[assetId];
 }
-std::map<std::string, SDL_Texture*> AssetStore::GetAllTextures() {
+const std::map<std::string, SDL_Texture*>& AssetStore::GetAllTextures() const {
     return m_textures;
 }
 
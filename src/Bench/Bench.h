@@ -0,0 +1,45 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+////////////////////////////////////////////////////////////////////////////////////
+// Bench
+////////////////////////////////////////////////////////////////////////////////////
+//// Helpers of the benchmark drivers of src/Bench. Every driver is one executable,
+//// built and run by "make bench" (or "make bench STORAGE=archetype"). They only link
+//// the ECS, the Logger and the Scheduler, no window is opened and SDL is never called.
+////////////////////////////////////////////////////////////////////////////////////
+
+namespace Bench {
+    // Milliseconds taken by func()
+    template <typename TFunc>
+    double Measure(TFunc func) {
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Fastest of numRuns calls to func(), the one the rest of the machine disturbed the least
+    template <typename TFunc>
+    double BestOf(int numRuns, TFunc func) {
+        double best = Measure(func);
+        for (int run = 1; run < numRuns; run++) {
+            best = std::min(best, Measure(func));
+        }
+        return best;
+    }
+
+    // A benchmark giving a wrong result measures nothing, the driver stops with an error
+    inline void Check(bool condition, const char* what) {
+        if (!condition) {
+            std::printf("FAILED: %s\n", what);
+            std::exit(1);
+        }
+    }
+}
+
+#endif
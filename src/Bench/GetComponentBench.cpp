@@ -0,0 +1,43 @@
+#include "./Bench.h"
+#include "../ECS/ECS.h"
+#include "../Components/TransformComponent.h"
+#include "../Components/RigidBodyComponent.h"
+#include <vector>
+
+// Cost of the component lookups of the systems looping over their entities (GetComponent, one
+// per component per entity and frame), and of the removals done when half of them are killed.
+int main() {
+    const int NUM_ENTITIES = 100000;
+
+    Registry registry;
+    std::vector<Entity> entities = registry.CreateEntities(NUM_ENTITIES);
+    for (auto entity: entities) {
+        entity.AddComponent<TransformComponent>(glm::vec2(entity.GetId(), 0), glm::vec2(1, 1), 0.0);
+        entity.AddComponent<RigidBodyComponent>(glm::vec2(1, 2));
+    }
+    registry.Update();
+
+    const int NUM_FRAMES = 50;
+    int numFrames = 0;
+    const double frameMs = Bench::BestOf(NUM_FRAMES, [&]() {
+        for (auto entity: entities) {
+            auto& transform = entity.GetComponent<TransformComponent>();
+            const auto& rigidBody = entity.GetComponent<const RigidBodyComponent>();
+            transform.position += rigidBody.velocity;
+        }
+        numFrames++;
+    });
+    Bench::Check(entities.back().GetComponent<const TransformComponent>().position.y == 2.0f * numFrames, "every frame moved the entities");
+
+    const double killMs = Bench::Measure([&]() {
+        for (int i = 0; i < NUM_ENTITIES; i += 2) {
+            entities[i].Kill();
+        }
+        registry.Update();
+    });
+    Bench::Check(!entities[0].IsAlive() && entities[1].IsAlive(), "half of the entities were killed");
+
+    std::printf("GetComponent x2 over %d entities: %.3f ms per frame (%.1f ns per lookup)\n", NUM_ENTITIES, frameMs, frameMs * 1e6 / (2.0 * NUM_ENTITIES));
+    std::printf("Kill %d entities + Registry::Update: %.3f ms\n", NUM_ENTITIES / 2, killMs);
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "./Bench.h"
+#include "../ECS/ECS.h"
+#include "../Scheduler/ParallelForEach.h"
+#include "../Scheduler/WorkerPool.h"
+#include "../Components/TransformComponent.h"
+#include "../Components/RigidBodyComponent.h"
+#include <cmath>
+
+// Scaling of a movement loop split by ParallelForEach on 1, 2, 4 and 8 threads (the calling
+// thread and a WorkerPool of threads - 1 workers). The loop moves 500k entities and kills from
+// the workers the ones leaving the map, so every thread count must end with the same entities
+// at the same positions.
+int main() {
+    const int NUM_ENTITIES = 500000;
+    const int NUM_FRAMES = 30;
+    const float MAP_SIZE = 2000.0f;
+
+    double singleThreadMs = 0;
+    double singleThreadChecksum = 0;
+    int singleThreadNumAlive = 0;
+    for (int numThreads: { 1, 2, 4, 8 }) {
+        Registry registry;
+        for (int i = 0; i < NUM_ENTITIES; i++) {
+            Entity entity = registry.CreateEntity();
+            entity.AddComponent<TransformComponent>(glm::vec2(i % 1999, (i * 7) % 1999));
+            entity.AddComponent<RigidBodyComponent>(glm::vec2((i % 3) - 1, (i % 5) - 2));
+        }
+        registry.Update();
+
+        WorkerPool workerPool(numThreads - 1);
+        double totalMs = 0;
+        double updateMs = 0;
+        for (int frame = 0; frame < NUM_FRAMES; frame++) {
+            totalMs += Bench::Measure([&]() {
+                ParallelForEach(workerPool, registry.View<TransformComponent, const RigidBodyComponent>(), [&](Entity entity, TransformComponent& transform, const RigidBodyComponent& rigidBody) {
+                    transform.position += rigidBody.velocity * 4.0f;
+                    transform.rotation = std::atan2(rigidBody.velocity.y, rigidBody.velocity.x);
+                    if (transform.position.x < 0 || transform.position.x > MAP_SIZE || transform.position.y < 0 || transform.position.y > MAP_SIZE) {
+                        entity.Kill();
+                    }
+                });
+            });
+            // Single threaded, the kills are applied here
+            updateMs += Bench::Measure([&]() { registry.Update(); });
+        }
+
+        double checksum = 0;
+        int numAlive = 0;
+        registry.View<const TransformComponent>().Each([&](Entity, const TransformComponent& transform) {
+            checksum += transform.position.x + transform.position.y;
+            numAlive++;
+        });
+        const double frameMs = totalMs / NUM_FRAMES;
+        if (numThreads == 1) {
+            singleThreadMs = frameMs;
+            singleThreadChecksum = checksum;
+            singleThreadNumAlive = numAlive;
+        }
+        Bench::Check(numAlive == singleThreadNumAlive && checksum == singleThreadChecksum, "every thread count moves and kills the same entities");
+
+        std::printf("%d thread(s), %d entities: %.3f ms per frame in the loop (x%.2f) + %.3f ms in Registry::Update, %d alive\n", numThreads, NUM_ENTITIES, frameMs, singleThreadMs / frameMs, updateMs / NUM_FRAMES, numAlive);
+    }
+    return 0;
+}
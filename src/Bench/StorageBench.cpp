@@ -0,0 +1,77 @@
+#include "./Bench.h"
+#include "../ECS/ECS.h"
+#include "../Components/TransformComponent.h"
+#include "../Components/RigidBodyComponent.h"
+#include "../Components/SpriteComponent.h"
+#include "../Components/BoxColliderComponent.h"
+
+// Iteration of the views of a tilemap level (50k tiles with a Transform and a Sprite, 5k actors
+// with a RigidBody and a BoxCollider too) by the movement, render and collision systems.
+// Run by "make bench" for the sparse sets and by "make bench STORAGE=archetype" for the chunks.
+int main() {
+    const int NUM_TILES = 50000;
+    const int NUM_ACTORS = 5000;
+
+#ifdef ECS_ARCHETYPE_STORAGE
+    const char* storage = "archetype";
+#else
+    const char* storage = "sparse set";
+#endif
+
+    Registry registry;
+    const double loadMs = Bench::Measure([&]() {
+        for (int i = 0; i < NUM_TILES; i++) {
+            Entity tile = registry.CreateEntity();
+            tile.AddComponent<TransformComponent>(glm::vec2(i % 500, i / 500));
+            tile.AddComponent<SpriteComponent>("tiles", 32, 32);
+        }
+        for (int i = 0; i < NUM_ACTORS; i++) {
+            Entity actor = registry.CreateEntity();
+            actor.AddComponent<TransformComponent>(glm::vec2(i, i));
+            actor.AddComponent<RigidBodyComponent>(glm::vec2(1, 2));
+            actor.AddComponent<SpriteComponent>("tank", 32, 32);
+            actor.AddComponent<BoxColliderComponent>(32, 32);
+        }
+        registry.Update();
+    });
+
+    const int NUM_RUNS = 30;
+    int numMoved = 0;
+    const double movementMs = Bench::BestOf(NUM_RUNS, [&]() {
+        numMoved = 0;
+        registry.View<TransformComponent, const RigidBodyComponent>().Each([&](Entity, TransformComponent& transform, const RigidBodyComponent& rigidBody) {
+            transform.position += rigidBody.velocity * 0.016f;
+            numMoved++;
+        });
+    });
+    Bench::Check(numMoved == NUM_ACTORS, "the movement view visits every actor");
+
+    int numDrawn = 0;
+    double sink = 0;
+    const double renderMs = Bench::BestOf(NUM_RUNS, [&]() {
+        numDrawn = 0;
+        registry.View<const TransformComponent, const SpriteComponent>().Each([&](Entity, const TransformComponent& transform, const SpriteComponent& sprite) {
+            sink += transform.position.x * sprite.width + sprite.zIndex;
+            numDrawn++;
+        });
+    });
+    Bench::Check(numDrawn == NUM_TILES + NUM_ACTORS, "the render view visits every tile and actor");
+
+    const double collisionMs = Bench::BestOf(NUM_RUNS, [&]() {
+        registry.View<const TransformComponent, const BoxColliderComponent>().Each([&](Entity, const TransformComponent& transform, const BoxColliderComponent& collider) {
+            sink += transform.position.y + collider.width;
+        });
+    });
+
+    const double allFourMs = Bench::BestOf(NUM_RUNS, [&]() {
+        registry.View<const TransformComponent, const RigidBodyComponent, const SpriteComponent, const BoxColliderComponent>().Each(
+            [&](Entity, const TransformComponent& transform, const RigidBodyComponent& rigidBody, const SpriteComponent& sprite, const BoxColliderComponent& collider) {
+                sink += transform.position.y + rigidBody.velocity.x + sprite.width + collider.width;
+            });
+    });
+    Bench::Check(sink != 0, "the views read the components");
+
+    std::printf("Storage %s, %d tiles + %d actors: load %.2f ms\n", storage, NUM_TILES, NUM_ACTORS, loadMs);
+    std::printf("  movement view %.3f ms, render view %.3f ms, collision view %.3f ms, four components view %.3f ms\n", movementMs, renderMs, collisionMs, allFourMs);
+    return 0;
+}
@@ -2,6 +2,7 @@
 #define ANIMATIONCOMPONENT_H
 
 #include <SDL2/SDL.h>
+#include "../Game/GameClock.h"
 
 struct AnimationComponent {
     int numFrames;
@@ -16,7 +17,7 @@ struct AnimationComponent {
         this->currentFrame = 1;
         this->frameSpeedRate = frameSpeedRate;
         this->isLoop = isLoop;
-        this->startTime=SDL_GetTicks();
+        this->startTime=GameClock::GetTicks();
     };
 };
 
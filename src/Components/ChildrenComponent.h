@@ -0,0 +1,15 @@
+#ifndef CHILDRENCOMPONENT_H
+#define CHILDRENCOMPONENT_H
+
+#include "../ECS/ECS.h"
+#include <vector>
+
+// Entities attached to this entity, kept by HierarchySystem. They are killed when it is removed,
+// with the entity or alone.
+struct ChildrenComponent {
+    std::vector<Entity> children;
+
+    ChildrenComponent() = default;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef COMPONENTMANIFEST_H
+#define COMPONENTMANIFEST_H
+
+// Every component type used with the Registry. The position of a type in the list is its
+// component id, and the length of the list is the size of the entity Signature.
+// This file is included by ECS.h, the component types only need to be declared here.
+// To add a component: declare it bellow and append it to the list.
+
+struct AnimationComponent;
+struct BoxColliderComponent;
+struct CameraFollowComponent;
+struct ChildrenComponent;
+struct HealthComponent;
+struct KeyboardControlledComponent;
+struct LuaScriptComponent;
+struct ParentComponent;
+struct ProjectileComponent;
+struct ProjectileEmitterComponent;
+struct RigidBodyComponent;
+struct SpriteComponent;
+struct TextLabelComponent;
+struct TransformComponent;
+
+typedef ComponentList<
+    AnimationComponent,
+    BoxColliderComponent,
+    CameraFollowComponent,
+    ChildrenComponent,
+    HealthComponent,
+    KeyboardControlledComponent,
+    LuaScriptComponent,
+    ParentComponent,
+    ProjectileComponent,
+    ProjectileEmitterComponent,
+    RigidBodyComponent,
+    SpriteComponent,
+    TextLabelComponent,
+    TransformComponent
+> ComponentManifest;
+
+#endif
@@ -2,13 +2,17 @@
 #define LUASCRIPTCOMPONENT_H
 
 #include <sol/sol.hpp>
+#include <string>
 
 struct LuaScriptComponent
 {
     sol::function func;
+    // Where the function comes from (see LevelLoader::FindScript), a Snapshot keeps the name only
+    std::string name;
 
-    LuaScriptComponent(sol::function func = sol::lua_nil) {
-        this->func = func;
+    LuaScriptComponent(sol::function func = sol::lua_nil, std::string name = "") {
+        this->func = std::move(func);
+        this->name = std::move(name);
     }
 };
 #endif
\ No newline at end of file
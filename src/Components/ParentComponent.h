@@ -0,0 +1,23 @@
+#ifndef PARENTCOMPONENT_H
+#define PARENTCOMPONENT_H
+
+#include "../ECS/ECS.h"
+#include <glm/glm.hpp>
+
+// Attaches an entity to a parent entity (see HierarchySystem::SetParent).
+// The TransformComponent of a child is computed from the transform of its parent and the local
+// values bellow, so a child is moved, scaled and rotated by changing them.
+struct ParentComponent {
+    Entity parent;
+    glm::vec2 localPosition;
+    glm::vec2 localScale;
+    double localRotation;
+
+    ParentComponent(Entity parent = Entity(-1), glm::vec2 localPosition = glm::vec2(0,0), glm::vec2 localScale = glm::vec2(1,1), double localRotation = 0.0): parent(parent) {
+        this->localPosition = localPosition;
+        this->localScale = localScale;
+        this->localRotation = localRotation;
+    }
+};
+
+#endif
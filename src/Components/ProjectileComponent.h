@@ -2,6 +2,7 @@
 #define PROJECTILECOMPONENT_H
 
 #include <SDL2/SDL.h>
+#include "../Game/GameClock.h"
 
 struct ProjectileComponent {
     bool isFriendly;
@@ -11,7 +12,7 @@ struct ProjectileComponent {
 
     ProjectileComponent(bool isFriendly = false, int hitPercentDamage = 0, int duration = 0) {
         this->isFriendly = isFriendly;
-        this->startTime = SDL_GetTicks();
+        this->startTime = GameClock::GetTicks();
         this->duration = duration;
         this->hitPercentDamage = hitPercentDamage;
     }
@@ -2,6 +2,7 @@
 #define PROJECTILEEMITTERCOMPONENT_H
 
 #include <SDL2/SDL.h>
+#include "../Game/GameClock.h"
 #include <glm/glm.hpp>
 
 struct ProjectileEmitterComponent {
@@ -20,7 +21,7 @@ struct ProjectileEmitterComponent {
         this->hitPercentDamage = hitPercentDamage;
         this->isFriendly = isFriendly;
         this->projectileDuration = projectileDuration;
-        this->lastEmissionTime = SDL_GetTicks();
+        this->lastEmissionTime = GameClock::GetTicks();
     }
 };
 
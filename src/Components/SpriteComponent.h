@@ -14,7 +14,7 @@ struct SpriteComponent {
     SDL_RendererFlip flip;
    
     SpriteComponent(std::string assetId = "", int width = 0, int height = 0, int srcRectX = 0, int srcRectY = 0, int zIndex = 0, bool isFixed = false) {
-        this->assetId = assetId;
+        this->assetId = std::move(assetId);
         this->width = width;
         this->height = height;
         this->srcRect = { srcRectX, srcRectY, width, height };
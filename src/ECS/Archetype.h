@@ -0,0 +1,486 @@
+#ifndef ARCHETYPE_H
+#define ARCHETYPE_H
+
+// Archetype storage backend of the Registry, enabled with ECS_ARCHETYPE_STORAGE (make build STORAGE=archetype).
+// This file is included by ECS.h right after the Signature definition, do not include it directly.
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+const size_t ARCHETYPE_CHUNK_SIZE = 16 * 1024;
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// ComponentTypeInfo
+///////////////////////////////////////////////////////////////////////////////////////////////
+//// Type erased description of a component type, so the archetype columns can move and
+///  destroy components stored as raw bytes without knowing their types.
+///////////////////////////////////////////////////////////////////////////////////////////////
+struct ComponentTypeInfo {
+    size_t size;
+    size_t alignment;
+    // Trivially copyable components are copied with a plain memcpy instead of copyConstruct
+    bool isTriviallyCopyable;
+    void (*moveConstruct)(void* destination, void* source);
+    void (*copyConstruct)(void* destination, const void* source);
+    void (*destroy)(void* component);
+};
+
+template <typename TComponent>
+const ComponentTypeInfo* GetComponentTypeInfo() {
+    static const ComponentTypeInfo info = {
+        sizeof(TComponent),
+        alignof(TComponent),
+        std::is_trivially_copyable<TComponent>::value,
+        [](void* destination, void* source) { new (destination) TComponent(std::move(*static_cast<TComponent*>(source))); },
+        [](void* destination, const void* source) { new (destination) TComponent(*static_cast<const TComponent*>(source)); },
+        [](void* component) { static_cast<TComponent*>(component)->~TComponent(); }
+    };
+    return &info;
+}
+
+// A component copied into new entities, see ArchetypeStorage::AddCopies
+struct ComponentPrototype {
+    int componentId;
+    const ComponentTypeInfo* type;
+    const void* component;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// Archetype
+///////////////////////////////////////////////////////////////////////////////////////////////
+//// All the entities that have exactly the same Signature. They are stored in fixed size chunks
+///  of ARCHETYPE_CHUNK_SIZE bytes, each chunk holds one column (SoA) of entity ids and one column
+///  per component type, so a query over a few components only touches those columns.
+///  Rows are always packed: removing a row moves the last row of the archetype into the hole.
+///////////////////////////////////////////////////////////////////////////////////////////////
+class Archetype {
+    private:
+        struct alignas(64) Chunk {
+            unsigned char bytes[ARCHETYPE_CHUNK_SIZE];
+        };
+
+        Signature m_signature;
+
+        // Column data, [column index] = component type. Column offsets are in bytes from the chunk start
+        std::vector<int> m_componentIds;
+        std::vector<const ComponentTypeInfo*> m_types;
+        std::vector<size_t> m_columnOffsets;
+        std::array<int, MAX_COMPONENTS> m_columnPerComponentId;
+
+        int m_chunkCapacity = 0;
+        int m_size = 0;
+        std::vector<std::unique_ptr<Chunk>> m_chunks;
+
+        static size_t AlignOffset(size_t offset, size_t alignment) {
+            return (offset + alignment - 1) & ~(alignment - 1);
+        }
+
+        // Lays out the columns for a given number of rows, returning the total bytes used
+        size_t ComputeLayout(int rows) {
+            size_t offset = sizeof(int) * rows; // entity ids column
+            for (size_t column = 0; column < m_types.size(); column++) {
+                offset = AlignOffset(offset, m_types[column]->alignment);
+                m_columnOffsets[column] = offset;
+                offset += m_types[column]->size * rows;
+            }
+            return offset;
+        }
+
+        unsigned char* GetCell(int column, int row) const {
+            unsigned char* chunk = m_chunks[row / m_chunkCapacity]->bytes;
+            return chunk + m_columnOffsets[column] + m_types[column]->size * (row % m_chunkCapacity);
+        }
+
+        int* GetEntityIdCell(int row) const {
+            return reinterpret_cast<int*>(m_chunks[row / m_chunkCapacity]->bytes) + (row % m_chunkCapacity);
+        }
+
+    public:
+        Archetype(const Signature& signature, const std::vector<const ComponentTypeInfo*>& typeInfoPerComponentId): m_signature(signature) {
+            m_columnPerComponentId.fill(-1);
+            for (unsigned int componentId = 0; componentId < MAX_COMPONENTS; componentId++) {
+                if (signature.test(componentId)) {
+                    m_columnPerComponentId[componentId] = static_cast<int>(m_componentIds.size());
+                    m_componentIds.push_back(componentId);
+                    m_types.push_back(typeInfoPerComponentId[componentId]);
+                }
+            }
+            m_columnOffsets.resize(m_types.size());
+
+            // Start from the capacity ignoring padding, and shrink until the aligned layout fits
+            size_t bytesPerRow = sizeof(int);
+            for (auto type: m_types) {
+                bytesPerRow += type->size;
+            }
+            m_chunkCapacity = static_cast<int>(ARCHETYPE_CHUNK_SIZE / bytesPerRow);
+            while (m_chunkCapacity > 1 && ComputeLayout(m_chunkCapacity) > ARCHETYPE_CHUNK_SIZE) {
+                m_chunkCapacity--;
+            }
+            ComputeLayout(m_chunkCapacity);
+        }
+
+        ~Archetype() {
+            for (int row = 0; row < m_size; row++) {
+                for (size_t column = 0; column < m_types.size(); column++) {
+                    m_types[column]->destroy(GetCell(column, row));
+                }
+            }
+        }
+
+        const Signature& GetSignature() const { return m_signature; }
+        int GetSize() const { return m_size; }
+        int GetChunkCapacity() const { return m_chunkCapacity; }
+        // Chunks that hold at least one row
+        int GetNumChunks() const { return (m_size + m_chunkCapacity - 1) / m_chunkCapacity; }
+        int GetColumn(int componentId) const { return m_columnPerComponentId[componentId]; }
+
+        // Rows used in a chunk, every chunk is full except the last one
+        int GetChunkSize(int chunk) const {
+            return (chunk == GetNumChunks() - 1) ? m_size - chunk * m_chunkCapacity : m_chunkCapacity;
+        }
+
+        // Raw column pointers of one chunk, used by the queries to walk the rows linearly
+        int* GetChunkEntityIds(int chunk) const {
+            return reinterpret_cast<int*>(m_chunks[chunk]->bytes);
+        }
+        void* GetChunkColumn(int chunk, int column) const {
+            return m_chunks[chunk]->bytes + m_columnOffsets[column];
+        }
+
+        void* GetComponent(int componentId, int row) const {
+            return GetCell(m_columnPerComponentId[componentId], row);
+        }
+
+        // Reserves a new row for the entity, the caller is responsible for constructing every component in it
+        int AllocateRow(int entityId) {
+            if (m_size == static_cast<int>(m_chunks.size()) * m_chunkCapacity) {
+                // Default initialized, the chunk bytes are not zeroed
+                m_chunks.push_back(std::unique_ptr<Chunk>(new Chunk));
+            }
+            const int row = m_size++;
+            *GetEntityIdCell(row) = entityId;
+            return row;
+        }
+
+        // Constructs the component in rows [firstRow, firstRow + numRows) as copies of a prototype
+        void CopyIntoRows(int componentId, int firstRow, int numRows, const void* prototype) {
+            const int column = m_columnPerComponentId[componentId];
+            const ComponentTypeInfo* type = m_types[column];
+            for (int row = firstRow; row < firstRow + numRows; row++) {
+                if (type->isTriviallyCopyable) {
+                    std::memcpy(GetCell(column, row), prototype, type->size);
+                } else {
+                    type->copyConstruct(GetCell(column, row), prototype);
+                }
+            }
+        }
+
+        // Destroys the components of a row and moves the last row into it.
+        // Returns the id of the entity that was moved into the row, or -1 if none was moved.
+        int RemoveRow(int row) {
+            const int lastRow = m_size - 1;
+            int movedEntityId = -1;
+
+            for (size_t column = 0; column < m_types.size(); column++) {
+                m_types[column]->destroy(GetCell(column, row));
+                if (row != lastRow) {
+                    m_types[column]->moveConstruct(GetCell(column, row), GetCell(column, lastRow));
+                    m_types[column]->destroy(GetCell(column, lastRow));
+                }
+            }
+            if (row != lastRow) {
+                movedEntityId = *GetEntityIdCell(lastRow);
+                *GetEntityIdCell(row) = movedEntityId;
+            }
+
+            // Empty chunks are kept (like a vector keeps its capacity), an entity moving through
+            // an archetype would otherwise allocate and free a chunk every time
+            m_size--;
+            return movedEntityId;
+        }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// ArchetypeStorage
+///////////////////////////////////////////////////////////////////////////////////////////////
+//// Owns all the archetypes and knows in which archetype/row each entity lives.
+///  Adding or removing a component moves the entity (and its other components) to the
+///  archetype of its new signature.
+///  Change ticks are kept per component type indexed by entity id, outside the chunks, so
+///  they stay put while the entities move between archetypes.
+///////////////////////////////////////////////////////////////////////////////////////////////
+class ArchetypeStorage {
+    private:
+        struct EntityLocation {
+            Archetype* archetype = nullptr;
+            int row = -1;
+        };
+
+        std::unordered_map<Signature, std::unique_ptr<Archetype>> m_archetypePerSignature;
+        std::vector<Archetype*> m_archetypes;
+
+        // [Vector index = entity id]
+        std::vector<EntityLocation> m_entityLocations;
+
+        // [Vector index = component id]
+        std::vector<const ComponentTypeInfo*> m_typeInfoPerComponentId;
+
+        // Tick of the last time each component was added or written.
+        // Mutable, the const getters hand out components for writing too.
+        // [Vector index = component id] [Inner vector index = entity id]
+        mutable std::vector<std::vector<unsigned int>> m_changeTicks;
+
+        Archetype* GetOrCreateArchetype(const Signature& signature) {
+            auto& archetype = m_archetypePerSignature[signature];
+            if (!archetype) {
+                archetype = std::make_unique<Archetype>(signature, m_typeInfoPerComponentId);
+                m_archetypes.push_back(archetype.get());
+            }
+            return archetype.get();
+        }
+
+        EntityLocation& GetLocation(int entityId) {
+            if (entityId >= static_cast<int>(m_entityLocations.size())) {
+                m_entityLocations.resize(entityId + 1);
+            }
+            return m_entityLocations[entityId];
+        }
+
+        // Moves the entity to the archetype of newSignature, moving the components both archetypes share.
+        // Components only in the new archetype are left unconstructed for the caller.
+        int MoveEntity(int entityId, const Signature& newSignature) {
+            EntityLocation& location = GetLocation(entityId);
+            Archetype* oldArchetype = location.archetype;
+            Archetype* newArchetype = newSignature.none() ? nullptr : GetOrCreateArchetype(newSignature);
+            int newRow = -1;
+
+            if (newArchetype) {
+                newRow = newArchetype->AllocateRow(entityId);
+            }
+            if (oldArchetype) {
+                if (newArchetype) {
+                    const Signature shared = oldArchetype->GetSignature() & newSignature;
+                    for (unsigned int componentId = 0; componentId < MAX_COMPONENTS; componentId++) {
+                        if (shared.test(componentId)) {
+                            m_typeInfoPerComponentId[componentId]->moveConstruct(
+                                newArchetype->GetComponent(componentId, newRow),
+                                oldArchetype->GetComponent(componentId, location.row)
+                            );
+                        }
+                    }
+                }
+                const int movedEntityId = oldArchetype->RemoveRow(location.row);
+                if (movedEntityId != -1) {
+                    m_entityLocations[movedEntityId].row = location.row;
+                }
+            }
+
+            location.archetype = newArchetype;
+            location.row = newRow;
+            return newRow;
+        }
+
+    public:
+        ArchetypeStorage() = default;
+        ~ArchetypeStorage() = default;
+
+        template <typename TComponent, typename ...TArgs>
+        void Add(int componentId, int entityId, const Signature& signature, unsigned int changeTick, TArgs&& ...args) {
+            if (componentId >= static_cast<int>(m_typeInfoPerComponentId.size())) {
+                m_typeInfoPerComponentId.resize(componentId + 1, nullptr);
+                m_changeTicks.resize(componentId + 1);
+            }
+            m_typeInfoPerComponentId[componentId] = GetComponentTypeInfo<TComponent>();
+
+            auto& changeTicks = m_changeTicks[componentId];
+            if (entityId >= static_cast<int>(changeTicks.size())) {
+                changeTicks.resize(entityId + 1, 0);
+            }
+            changeTicks[entityId] = changeTick;
+
+            if (signature.test(componentId)) {
+                // if the entity already has the component, simply replace the component object
+                Get<TComponent>(componentId, entityId) = TComponent(std::forward<TArgs>(args)...);
+                return;
+            }
+
+            Signature newSignature = signature;
+            newSignature.set(componentId);
+            const int row = MoveEntity(entityId, newSignature);
+            new (m_entityLocations[entityId].archetype->GetComponent(componentId, row)) TComponent(std::forward<TArgs>(args)...);
+        }
+
+        // Adds entities that have no components yet straight to the archetype of signature, with every
+        // component copied from its prototype. The rows are appended together, one column at a time.
+        void AddCopies(const std::vector<int>& entityIds, const Signature& signature, unsigned int changeTick, const std::vector<ComponentPrototype>& prototypes) {
+            if (entityIds.empty() || signature.none()) {
+                return;
+            }
+            const int maxEntityId = *std::max_element(entityIds.begin(), entityIds.end());
+            for (const auto& prototype: prototypes) {
+                if (prototype.componentId >= static_cast<int>(m_typeInfoPerComponentId.size())) {
+                    m_typeInfoPerComponentId.resize(prototype.componentId + 1, nullptr);
+                    m_changeTicks.resize(prototype.componentId + 1);
+                }
+                m_typeInfoPerComponentId[prototype.componentId] = prototype.type;
+
+                auto& changeTicks = m_changeTicks[prototype.componentId];
+                if (maxEntityId >= static_cast<int>(changeTicks.size())) {
+                    changeTicks.resize(maxEntityId + 1, 0);
+                }
+                for (int entityId: entityIds) {
+                    changeTicks[entityId] = changeTick;
+                }
+            }
+
+            Archetype* archetype = GetOrCreateArchetype(signature);
+            const int firstRow = archetype->GetSize();
+            for (int entityId: entityIds) {
+                EntityLocation& location = GetLocation(entityId);
+                location.archetype = archetype;
+                location.row = archetype->AllocateRow(entityId);
+            }
+            for (const auto& prototype: prototypes) {
+                archetype->CopyIntoRows(prototype.componentId, firstRow, static_cast<int>(entityIds.size()), prototype.component);
+            }
+        }
+
+        void Remove(int componentId, int entityId, const Signature& signature) {
+            Signature newSignature = signature;
+            newSignature.reset(componentId);
+            MoveEntity(entityId, newSignature);
+        }
+
+        void RemoveEntity(int entityId) {
+            if (entityId < static_cast<int>(m_entityLocations.size()) && m_entityLocations[entityId].archetype) {
+                MoveEntity(entityId, Signature());
+            }
+        }
+
+        // Does not touch the change tick, use it to read the component
+        template <typename TComponent>
+        TComponent& Get(int componentId, int entityId) const {
+            const EntityLocation& location = m_entityLocations[entityId];
+            return *static_cast<TComponent*>(location.archetype->GetComponent(componentId, location.row));
+        }
+
+        // Get to write the component, stamping its change tick
+        template <typename TComponent>
+        TComponent& GetMutable(int componentId, int entityId, unsigned int changeTick) const {
+            m_changeTicks[componentId][entityId] = changeTick;
+            return Get<TComponent>(componentId, entityId);
+        }
+
+        unsigned int GetChangeTick(int componentId, int entityId) const {
+            return m_changeTicks[componentId][entityId];
+        }
+
+        void RestampIfChangedAfter(int componentId, int entityId, unsigned int sinceTick, unsigned int changeTick) {
+            auto& tick = m_changeTicks[componentId][entityId];
+            if (tick > sinceTick) {
+                tick = changeTick;
+            }
+        }
+
+        // Calls func(entityId, TComponents&...) for every entity whose archetype contains all the component ids,
+        // walking the matching archetypes chunk by chunk over their raw columns.
+        // Non const TComponents are stamped with changeTick. When changedComponentId is not -1, only the
+        // entities whose component changedComponentId changed after sinceTick are visited.
+        // Entities that are not active ([entity id] = false, they sleep) are skipped.
+        template <typename ...TComponents, typename TFunc>
+        void Each(const std::array<int, sizeof...(TComponents)>& componentIds, unsigned int changeTick, const std::vector<bool>& activeEntities, TFunc& func, int changedComponentId = -1, unsigned int sinceTick = 0) const {
+            const Signature required = GetRequiredSignature(componentIds);
+
+            for (Archetype* archetype: m_archetypes) {
+                if ((archetype->GetSignature() & required) != required) {
+                    continue;
+                }
+
+                const auto columns = GetColumns(archetype, componentIds);
+                for (int chunk = 0; chunk < archetype->GetNumChunks(); chunk++) {
+                    EachInArchetypeChunk<TComponents...>(archetype, chunk, columns, componentIds, changeTick, activeEntities, func, changedComponentId, sinceTick, std::index_sequence_for<TComponents...>{});
+                }
+            }
+        }
+
+        // Number of chunks in the archetypes that contain all the component ids, they are numbered
+        // in the order Each() visits them so they can be iterated separately with EachInChunk()
+        template <size_t N>
+        int GetNumChunks(const std::array<int, N>& componentIds) const {
+            const Signature required = GetRequiredSignature(componentIds);
+            int numChunks = 0;
+            for (Archetype* archetype: m_archetypes) {
+                if ((archetype->GetSignature() & required) == required) {
+                    numChunks += archetype->GetNumChunks();
+                }
+            }
+            return numChunks;
+        }
+
+        template <typename ...TComponents, typename TFunc>
+        void EachInChunk(const std::array<int, sizeof...(TComponents)>& componentIds, int chunk, unsigned int changeTick, const std::vector<bool>& activeEntities, TFunc& func) const {
+            const Signature required = GetRequiredSignature(componentIds);
+
+            for (Archetype* archetype: m_archetypes) {
+                if ((archetype->GetSignature() & required) != required) {
+                    continue;
+                }
+                if (chunk >= archetype->GetNumChunks()) {
+                    chunk -= archetype->GetNumChunks();
+                    continue;
+                }
+                EachInArchetypeChunk<TComponents...>(archetype, chunk, GetColumns(archetype, componentIds), componentIds, changeTick, activeEntities, func, -1, 0, std::index_sequence_for<TComponents...>{});
+                return;
+            }
+        }
+
+    private:
+        template <size_t N>
+        static Signature GetRequiredSignature(const std::array<int, N>& componentIds) {
+            Signature required;
+            for (int componentId: componentIds) {
+                required.set(componentId);
+            }
+            return required;
+        }
+
+        template <size_t N>
+        static std::array<int, N> GetColumns(const Archetype* archetype, const std::array<int, N>& componentIds) {
+            std::array<int, N> columns;
+            for (size_t i = 0; i < N; i++) {
+                columns[i] = archetype->GetColumn(componentIds[i]);
+            }
+            return columns;
+        }
+
+        template <typename TComponent>
+        static void StampIfMutable(unsigned int* changeTicks, int entityId, unsigned int changeTick) {
+            if constexpr (!std::is_const<TComponent>::value) {
+                changeTicks[entityId] = changeTick;
+            }
+        }
+
+        template <typename ...TComponents, typename TFunc, size_t ...Is>
+        void EachInArchetypeChunk(Archetype* archetype, int chunk, const std::array<int, sizeof...(TComponents)>& columns, const std::array<int, sizeof...(TComponents)>& componentIds,
+                                  unsigned int changeTick, const std::vector<bool>& activeEntities, TFunc& func, int changedComponentId, unsigned int sinceTick, std::index_sequence<Is...>) const {
+            const int size = archetype->GetChunkSize(chunk);
+            const int* entityIds = archetype->GetChunkEntityIds(chunk);
+            std::tuple<TComponents*...> columnData(static_cast<TComponents*>(archetype->GetChunkColumn(chunk, columns[Is]))...);
+            std::array<unsigned int*, sizeof...(TComponents)> changeTicks{ m_changeTicks[componentIds[Is]].data()... };
+            const unsigned int* changedTicks = changedComponentId != -1 ? m_changeTicks[changedComponentId].data() : nullptr;
+
+            for (int row = 0; row < size; row++) {
+                const int entityId = entityIds[row];
+                if (!activeEntities[entityId] || (changedTicks && changedTicks[entityId] <= sinceTick)) {
+                    continue;
+                }
+                (StampIfMutable<TComponents>(changeTicks[Is], entityId, changeTick), ...);
+                func(entityId, std::get<Is>(columnData)[row]...);
+            }
+        }
+};
+
+#endif
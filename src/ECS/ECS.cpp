@@ -3,30 +3,64 @@
 #include <vector>
 #include <algorithm>
 
-int IComponent::m_nextId = 0;
+std::unordered_map<std::string, TagId> Registry::m_tagIds;
+std::unordered_map<std::string, GroupId> Registry::m_groupIds;
 
 // Entity ##########################################################################
 int Entity::GetId() const {
     return m_id;
 }
 
+unsigned int Entity::GetGeneration() const {
+    return m_generation;
+}
+
+bool Entity::IsAlive() const {
+    // Handles that never came from a registry (ex: Entity(-1) in a default ParentComponent) are not alive
+    return m_registry && m_registry->IsAlive(*this);
+}
+
 void Entity::Kill() {
     m_registry->KillEntity(*this);
 }
 
+void Entity::SetActive(bool isActive) {
+    m_registry->SetEntityActive(*this, isActive);
+}
+
+bool Entity::IsActive() const {
+    return m_registry->IsActive(*this);
+}
+
 void Entity::Tag(const std::string& tag) {
+        m_registry->TagEntity(*this, Registry::GetTagId(tag));
+}
+
+void Entity::Tag(TagId tag) {
         m_registry->TagEntity(*this, tag);
 }
 
 bool Entity::HasTag(const std::string& tag) const {
+        return m_registry->EntityHasTag(*this, Registry::GetTagId(tag));
+}
+
+bool Entity::HasTag(TagId tag) const {
         return m_registry->EntityHasTag(*this, tag);
 }
 
 void Entity::Group(const std::string& group) {
+        m_registry->GroupEntity(*this, Registry::GetGroupId(group));
+}
+
+void Entity::Group(GroupId group) {
         m_registry->GroupEntity(*this, group);
 }
 
 bool Entity::BelongsToGroup(const std::string& group) const {
+        return m_registry->EntityBelongsToGroup(*this, Registry::GetGroupId(group));
+}
+
+bool Entity::BelongsToGroup(GroupId group) const {
         return m_registry->EntityBelongsToGroup(*this, group);
 }
 
@@ -34,16 +68,38 @@ bool Entity::BelongsToGroup(const std::string& group) const {
 // System ##########################################################################
 
 void System::AddEntityToSystem(Entity entity) {
+    const auto entityId = entity.GetId();
+    if (entityId >= static_cast<int>(m_entityIndexes.size())) {
+        m_entityIndexes.resize(entityId + 1, -1);
+    }
+    if (m_entityIndexes[entityId] != -1) {
+        return;
+    }
+    m_entityIndexes[entityId] = static_cast<int>(m_entities.size());
     m_entities.push_back(entity);
 }
 
 void System::RemoveEntityFromSystem(Entity entity) {
-    m_entities.erase(std::remove_if(m_entities.begin(), m_entities.end(), [&entity](Entity other) {
-        return entity == other;
-    }), m_entities.end());
+    if (!HasEntity(entity)) {
+        return;
+    }
+
+    // Move the last entity to the removed position to keep the vector packed
+    const int indexOfRemoved = m_entityIndexes[entity.GetId()];
+    const Entity last = m_entities.back();
+    m_entities[indexOfRemoved] = last;
+    m_entityIndexes[last.GetId()] = indexOfRemoved;
+
+    m_entityIndexes[entity.GetId()] = -1;
+    m_entities.pop_back();
+}
+
+bool System::HasEntity(Entity entity) const {
+    const auto entityId = entity.GetId();
+    return entityId < static_cast<int>(m_entityIndexes.size()) && m_entityIndexes[entityId] != -1;
 }
 
-std::vector<Entity> System::GetSystemEntities() const {
+const std::vector<Entity>& System::GetSystemEntities() const {
     return m_entities;
 }
 
@@ -51,6 +107,91 @@ const Signature& System::GetComponentSignature() const {
     return m_componentSignature;
 }
 
+void System::RequireExclusiveAccess() {
+    m_isExclusive = true;
+}
+
+const Signature& System::GetReadSignature() const {
+    return m_readSignature;
+}
+
+const Signature& System::GetWriteSignature() const {
+    return m_writeSignature;
+}
+
+bool System::IsExclusive() const {
+    return m_isExclusive;
+}
+
+// CommandBuffer ##########################################################################
+
+Entity CommandBuffer::CreateEntity(Entity spawner) {
+    Entity placeholder(ToPlaceholderId(static_cast<int>(m_spawnerIds.size())));
+    placeholder.m_registry = spawner.m_registry;
+    m_spawnerIds.push_back(spawner.GetId());
+    m_prefabs.push_back(nullptr);
+    m_isEmpty = false;
+    return placeholder;
+}
+
+Entity CommandBuffer::Instantiate(Entity spawner, const Prefab& prefab) {
+    Entity placeholder = CreateEntity(spawner);
+    m_prefabs.back() = &prefab;
+    return placeholder;
+}
+
+void CommandBuffer::SetEntityActive(Entity entity, bool isActive) {
+    m_activeChanges.emplace_back(entity, isActive);
+    m_isEmpty = false;
+}
+
+void CommandBuffer::KillEntity(Entity entity) {
+    m_kills.push_back(entity);
+    m_isEmpty = false;
+}
+
+void CommandBuffer::GroupEntity(Entity entity, GroupId group) {
+    m_groups.emplace_back(entity, group);
+    m_isEmpty = false;
+}
+
+bool CommandBuffer::IsEmpty() const {
+    return m_isEmpty;
+}
+
+void CommandBuffer::Clear() {
+    // Keep the capacity of the vectors and the component lists for the next frame
+    m_spawnerIds.clear();
+    m_prefabs.clear();
+    m_createdEntities.clear();
+    m_groups.clear();
+    m_removals.clear();
+    for (auto& additions: m_additions) {
+        if (additions) {
+            additions->Clear();
+        }
+    }
+    m_activeChanges.clear();
+    m_kills.clear();
+    m_isEmpty = true;
+}
+
+// Prefab ##########################################################################
+
+void Prefab::Group(GroupId group) {
+    if (std::find(m_groups.begin(), m_groups.end(), group) == m_groups.end()) {
+        m_groups.push_back(group);
+    }
+}
+
+void Prefab::Group(const std::string& group) {
+    Group(Registry::GetGroupId(group));
+}
+
+const Signature& Prefab::GetSignature() const {
+    return m_signature;
+}
+
 // Registry ##########################################################################
 Entity Registry::CreateEntity(){
     
@@ -60,9 +201,16 @@ Entity Registry::CreateEntity(){
         // If there are no free id's waiting to be reused, then we create and resize.
         entityId = m_numEntities++;
 
-        //Make sure the entityComponentSignatures vector can accomodate the new entity
+        //Make sure the entityComponentSignatures, generation, tag and group vectors can accomodate the new entity
         if (entityId >= static_cast<int>(m_entityComponentSignatures.size())) {
             m_entityComponentSignatures.resize(entityId + 1);
+            // The generations outlive Clear(), they only grow
+            if (entityId >= static_cast<int>(m_entityGenerations.size())) {
+                m_entityGenerations.resize(entityId + 1, 0);
+            }
+            m_entityIsActive.resize(entityId + 1, true);
+            tagPerEntity.resize(entityId + 1, -1);
+            groupsPerEntity.resize(entityId + 1);
         }
     }
     // Reuse an id from the list previously removed
@@ -72,11 +220,11 @@ Entity Registry::CreateEntity(){
         Logger::Log("Entity ID reused for creation with id = " + std::to_string(entityId));
     }
 
-    Entity entity(entityId);
-    entity.m_registry = this;
+    // The generation was bumped when the id was freed, old handles to it are not alive
+    Entity entity = GetEntity(entityId);
 
     // Flagging new entity to be added
-    m_entitiesTobeAdded.insert(entity);
+    m_entitiesTobeAdded.push_back(entity);
 
     
     //Logger::Log("Entity flagged for creation with id = " + std::to_string(entityId));
@@ -84,124 +232,659 @@ Entity Registry::CreateEntity(){
     
 };
 
+std::vector<Entity> Registry::CreateEntities(int n) {
+    std::vector<Entity> entities;
+    CreateEntities(n, entities);
+    return entities;
+}
+
+void Registry::CreateEntities(int n, std::vector<Entity>& entities) {
+    if (n <= 0) {
+        return;
+    }
+    const size_t firstEntity = entities.size();
+    entities.reserve(firstEntity + n);
+
+    // Reuse the ids previously removed first
+    int numReused = 0;
+    while (!m_freeIds.empty() && numReused < n) {
+        entities.push_back(GetEntity(m_freeIds.front()));
+        m_freeIds.pop_front();
+        numReused++;
+    }
+
+    // Then append new ids, resizing the per entity vectors once
+    const int numNewEntities = n - numReused;
+    const int firstNewId = m_numEntities;
+    m_numEntities += numNewEntities;
+    if (m_numEntities > static_cast<int>(m_entityComponentSignatures.size())) {
+        m_entityComponentSignatures.resize(m_numEntities);
+        if (m_numEntities > static_cast<int>(m_entityGenerations.size())) {
+            m_entityGenerations.resize(m_numEntities, 0);
+        }
+        m_entityIsActive.resize(m_numEntities, true);
+        tagPerEntity.resize(m_numEntities, -1);
+        groupsPerEntity.resize(m_numEntities);
+    }
+    for (int entityId = firstNewId; entityId < m_numEntities; entityId++) {
+        entities.push_back(GetEntity(entityId));
+    }
+
+    m_entitiesTobeAdded.insert(m_entitiesTobeAdded.end(), entities.begin() + firstEntity, entities.end());
+}
+
+std::vector<Entity> Registry::Instantiate(const Prefab& prefab, int count) {
+    const auto entities = CreateEntities(count);
+    AddPrefabComponents(prefab, entities);
+    return entities;
+}
+
+void Registry::AddPrefabComponents(const Prefab& prefab, const std::vector<Entity>& entities) {
+    if (entities.empty()) {
+        return;
+    }
+
+#ifdef ECS_ARCHETYPE_STORAGE
+    // One archetype for all the entities, every column is filled in one go
+    std::vector<ComponentPrototype> prototypes;
+    for (int componentId = 0; componentId < static_cast<int>(MAX_COMPONENTS); componentId++) {
+        if (prefab.m_signature.test(componentId)) {
+            prototypes.push_back(prefab.m_components[componentId]->GetPrototype());
+        }
+    }
+    std::vector<int> entityIds;
+    entityIds.reserve(entities.size());
+    for (const auto& entity: entities) {
+        entityIds.push_back(entity.GetId());
+    }
+    m_archetypeStorage.AddCopies(entityIds, prefab.m_signature, GetChangeTick(), prototypes);
+    for (const auto& entity: entities) {
+        m_entityComponentSignatures[entity.GetId()] = prefab.m_signature;
+    }
+#else
+    // One pool at a time, then the owning groups once the entities have all their components
+    for (int componentId = 0; componentId < static_cast<int>(MAX_COMPONENTS); componentId++) {
+        if (prefab.m_signature.test(componentId)) {
+            prefab.m_components[componentId]->AddCopies(*this, entities);
+        }
+    }
+    for (auto& group: m_owningGroups) {
+        if ((prefab.m_signature & group->owned) == group->owned) {
+            for (const auto& entity: entities) {
+                EnterOwningGroup(*group, entity.GetId());
+            }
+        }
+    }
+#endif
+
+    for (int componentId = 0; componentId < static_cast<int>(m_onComponentAdded.size()); componentId++) {
+        if (prefab.m_signature.test(componentId)) {
+            for (const auto& entity: entities) {
+                NotifyComponentAdded(componentId, entity);
+            }
+        }
+    }
+    for (GroupId group: prefab.m_groups) {
+        GroupEntities(entities, group);
+    }
+}
+
+Prefab& Registry::AddPrefab(const std::string& name) {
+    Prefab& prefab = m_prefabs[name];
+    prefab = Prefab();
+    return prefab;
+}
+
+const Prefab* Registry::GetPrefab(const std::string& name) const {
+    auto prefab = m_prefabs.find(name);
+    return prefab != m_prefabs.end() ? &prefab->second : nullptr;
+}
+
 void Registry::KillEntity(Entity entity) {
-    m_entitiesToBeKilled.insert(entity);
+    const int threadSlot = GetThreadSlot();
+    if (threadSlot != -1) {
+        m_commandBuffers[threadSlot].KillEntity(entity);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_overflowCommandBufferMutex);
+    m_overflowCommandBuffer.KillEntity(entity);
 }
 
-void Registry::AddEntityToSystems(Entity entity) {
+void Registry::SetEntityActive(Entity entity, bool isActive) {
+    const int threadSlot = GetThreadSlot();
+    if (threadSlot != -1) {
+        m_commandBuffers[threadSlot].SetEntityActive(entity, isActive);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_overflowCommandBufferMutex);
+    m_overflowCommandBuffer.SetEntityActive(entity, isActive);
+}
+
+void Registry::ApplyEntityActive(Entity entity, bool isActive) {
     const auto entityId = entity.GetId();
+    if (m_entityIsActive[entityId] == isActive) {
+        return;
+    }
 
-    // Component signatures for that entity
-    const auto entityComponentSignature = m_entityComponentSignatures[entityId];
+    if (!isActive) {
+        RemoveEntityFromSystems(entity);
+#ifndef ECS_ARCHETYPE_STORAGE
+        for (auto& group: m_owningGroups) {
+            LeaveOwningGroup(*group, entityId);
+        }
+#endif
+        m_entityIsActive[entityId] = false;
+        if (entityId >= static_cast<int>(m_entitySleepTicks.size())) {
+            m_entitySleepTicks.resize(entityId + 1, 0);
+        }
+        // The components written earlier in this tick were not seen by the systems yet either
+        m_entitySleepTicks[entityId] = GetChangeTick() - 1;
+    } else {
+        m_entityIsActive[entityId] = true;
+        // Entities loaded asleep (see Snapshot) have no tick, all their components are new
+        const unsigned int sleepTick = entityId < static_cast<int>(m_entitySleepTicks.size()) ? m_entitySleepTicks[entityId] : 0;
+        const auto& signature = m_entityComponentSignatures[entityId];
+        for (int componentId = 0; componentId < static_cast<int>(MAX_COMPONENTS); componentId++) {
+            if (signature.test(componentId)) {
+#ifdef ECS_ARCHETYPE_STORAGE
+                m_archetypeStorage.RestampIfChangedAfter(componentId, entityId, sleepTick, GetChangeTick());
+#else
+                m_componentTypePools[componentId]->RestampIfChangedAfter(entityId, sleepTick, GetChangeTick());
+#endif
+            }
+        }
+#ifndef ECS_ARCHETYPE_STORAGE
+        for (auto& group: m_owningGroups) {
+            EnterOwningGroup(*group, entityId);
+        }
+#endif
+        // Adding an entity to a system twice does nothing, so the entities created in this frame
+        // (still in m_entitiesTobeAdded) can be added here too
+        AddEntityToSystems(entity);
+    }
+}
 
-    // Loop all the system
+CommandBuffer& Registry::GetCommandBuffer() {
+    const int threadSlot = GetThreadSlot();
+    if (threadSlot != -1) {
+        return m_commandBuffers[threadSlot];
+    }
+
+    // Only reachable with more than MAX_THREAD_SLOTS threads alive, the WorkerPool never starts that many
+    Logger::Error("No thread slot left for a command buffer, recording into the shared buffer");
+    return m_overflowCommandBuffer;
+}
+
+// Thread slots not used by any living thread
+static std::mutex freeThreadSlotsMutex;
+static std::vector<int> freeThreadSlots;
+static int numThreadSlots = 0;
+
+// Takes a slot on construction and gives it back when its thread exits
+struct ThreadSlot {
+    int index = -1;
+
+    ThreadSlot() {
+        std::lock_guard<std::mutex> lock(freeThreadSlotsMutex);
+        if (!freeThreadSlots.empty()) {
+            index = freeThreadSlots.back();
+            freeThreadSlots.pop_back();
+        }
+        else if (numThreadSlots < static_cast<int>(MAX_THREAD_SLOTS)) {
+            index = numThreadSlots++;
+        }
+    }
+
+    ~ThreadSlot() {
+        if (index != -1) {
+            std::lock_guard<std::mutex> lock(freeThreadSlotsMutex);
+            freeThreadSlots.push_back(index);
+        }
+    }
+};
+
+int Registry::GetThreadSlot() {
+    static thread_local ThreadSlot threadSlot;
+    return threadSlot.index;
+}
+
+const std::vector<System*>& Registry::GetInterestedSystems(const Signature& entitySignature) {
+    auto cached = m_systemsPerSignature.find(entitySignature);
+    if (cached != m_systemsPerSignature.end()) {
+        return cached->second;
+    }
+
+    // First time we see this signature, test it against every system once
+    std::vector<System*> interestedSystems;
     for (auto& system: m_systems) {
         const auto& systemComponentSignature = system.second->GetComponentSignature();
 
-        // Check each bit from one bitset with another, if all of them match we add that entity to the system.
-        bool isInterested = (entityComponentSignature & systemComponentSignature) == systemComponentSignature;
+        // Check each bit from one bitset with another, if all of them match the system is interested.
+        bool isInterested = (entitySignature & systemComponentSignature) == systemComponentSignature;
         if (isInterested) {
-            // Add the entity to the system
-            system.second->AddEntityToSystem(entity);
+            interestedSystems.push_back(system.second.get());
         }
     }
+    return m_systemsPerSignature.emplace(entitySignature, std::move(interestedSystems)).first->second;
+}
+
+void Registry::AddEntityToSystems(Entity entity) {
+    const auto entityId = entity.GetId();
+
+    // Component signatures for that entity
+    const auto& entityComponentSignature = m_entityComponentSignatures[entityId];
+
+    if (entityId >= static_cast<int>(m_entitySystemSignatures.size())) {
+        m_entitySystemSignatures.resize(entityId + 1);
+    }
+    m_entitySystemSignatures[entityId] = entityComponentSignature;
+
+    // Add the entity only to the systems that are interested in its signature
+    for (auto system: GetInterestedSystems(entityComponentSignature)) {
+        system->AddEntityToSystem(entity);
+    }
 }
 
 void Registry::RemoveEntityFromSystems(Entity entity) {
-    for (auto system: m_systems) {
-        system.second->RemoveEntityFromSystem(entity);
-    };
+    const auto entityId = entity.GetId();
+    if (entityId >= static_cast<int>(m_entitySystemSignatures.size())) {
+        return;
+    }
 
+    // Route the removal with the signature the entity was added with, its components may have changed since
+    for (auto system: GetInterestedSystems(m_entitySystemSignatures[entityId])) {
+        system->RemoveEntityFromSystem(entity);
+    }
+    m_entitySystemSignatures[entityId].reset();
 }
 
-void Registry::TagEntity(Entity entity, const std::string& tag) {
+TagId Registry::GetTagId(const std::string& tag) {
+    // New names get the next id, the map is only written the first time a name is seen
+    return m_tagIds.emplace(tag, static_cast<TagId>(m_tagIds.size())).first->second;
+}
+
+GroupId Registry::GetGroupId(const std::string& group) {
+    auto groupId = m_groupIds.emplace(group, static_cast<GroupId>(m_groupIds.size())).first->second;
+    if (groupId >= static_cast<GroupId>(MAX_GROUPS)) {
+        Logger::Error("Too many entity groups, the group " + group + " exceeds MAX_GROUPS");
+    }
+    return groupId;
+}
+
+void Registry::TagEntity(Entity entity, TagId tag) {
+    // One tag per entity and one entity per tag, take the tag away from any previous owner
+    RemoveEntityTag(entity);
+    auto previousOwner = entityPerTag.find(tag);
+    if (previousOwner != entityPerTag.end()) {
+        RemoveEntityTag(previousOwner->second);
+    }
     entityPerTag.emplace(tag, entity);
-    tagPerEntity.emplace(entity.GetId(), tag);
+    tagPerEntity[entity.GetId()] = tag;
 }
 
-bool Registry::EntityHasTag(Entity entity, const std::string& tag) const {
-        if (tagPerEntity.find(entity.GetId()) == tagPerEntity.end()) {
-            return false;
-        }
-        return entityPerTag.find(tag)->second == entity;
+bool Registry::EntityHasTag(Entity entity, TagId tag) const {
+    return IsAlive(entity) && tagPerEntity[entity.GetId()] == tag;
 }
 
-Entity Registry::GetEntityByTag(const std::string& tag) const {
+Entity Registry::GetEntityByTag(TagId tag) const {
     return entityPerTag.at(tag);
 }
 
+Entity Registry::GetEntityByTag(const std::string& tag) const {
+    return GetEntityByTag(GetTagId(tag));
+}
+
 void Registry::RemoveEntityTag(Entity entity) {
-        auto taggedEntity = tagPerEntity.find(entity.GetId());
-    if (taggedEntity != tagPerEntity.end()) {
-        auto tag = taggedEntity->second;
+    auto& tag = tagPerEntity[entity.GetId()];
+    if (tag != -1) {
         entityPerTag.erase(tag);
-        tagPerEntity.erase(taggedEntity);
+        tag = -1;
     }
 }
 
-void Registry::GroupEntity(Entity entity, const std::string& group) {
-    entitiesPerGroup.emplace(group, std::set<Entity>());
+void Registry::GroupEntity(Entity entity, GroupId group) {
+    if (group >= static_cast<int>(entitiesPerGroup.size())) {
+        entitiesPerGroup.resize(group + 1);
+    }
     entitiesPerGroup[group].emplace(entity);
-    groupPerEntity.emplace(entity.GetId(), group);
+    groupsPerEntity[entity.GetId()].set(group);
 }
 
-bool Registry::EntityBelongsToGroup(Entity entity, const std::string& group) const {
-    // If do not find
-    if (entitiesPerGroup.find(group) == entitiesPerGroup.end()) {
-        return false;
+void Registry::GroupEntities(const std::vector<Entity>& entities, GroupId group) {
+    if (group >= static_cast<int>(entitiesPerGroup.size())) {
+        entitiesPerGroup.resize(group + 1);
+    }
+    auto& groupEntities = entitiesPerGroup[group];
+    for (auto entity: entities) {
+        // Hinted at the end, so ascending ids are inserted in amortized constant time
+        groupEntities.emplace_hint(groupEntities.end(), entity);
+        groupsPerEntity[entity.GetId()].set(group);
     }
-    auto groupEntities = entitiesPerGroup.at(group);
-    return groupEntities.find(entity.GetId()) != groupEntities.end();
 }
 
-std::vector<Entity> Registry::GetEntitiesByGroup(const std::string& group) const {
-    auto& setOfEntities = entitiesPerGroup.at(group);
+bool Registry::EntityBelongsToGroup(Entity entity, GroupId group) const {
+    return IsAlive(entity) && groupsPerEntity[entity.GetId()].test(group);
+}
+
+std::vector<Entity> Registry::GetEntitiesByGroup(GroupId group) const {
+    if (group >= static_cast<int>(entitiesPerGroup.size())) {
+        return std::vector<Entity>();
+    }
+    auto& setOfEntities = entitiesPerGroup[group];
     return std::vector<Entity>(setOfEntities.begin(), setOfEntities.end());
 }
 
+std::vector<Entity> Registry::GetEntitiesByGroup(const std::string& group) const {
+    return GetEntitiesByGroup(GetGroupId(group));
+}
+
 void Registry::RemoveEntityGroup(Entity entity) {
-    // if in group, remove entity from group management
-    auto groupedEntity = groupPerEntity.find(entity.GetId());
-    if (groupedEntity != groupPerEntity.end()) {
-        auto group = entitiesPerGroup.find(groupedEntity->second);
-        if (group != entitiesPerGroup.end()) {
-            auto entityInGroup = group->second.find(entity);
-            if (entityInGroup != group->second.end()) {
-                group->second.erase(entityInGroup);
-            }
+    // if in any group, remove entity from group management
+    auto& groups = groupsPerEntity[entity.GetId()];
+    for (GroupId group = 0; groups.any() && group < static_cast<GroupId>(entitiesPerGroup.size()); group++) {
+        if (groups.test(group)) {
+            entitiesPerGroup[group].erase(entity);
+            groups.reset(group);
         }
-        groupPerEntity.erase(groupedEntity);
     }
 }
 
-void Registry::Update() {
-    // processing the entitites that are waiting to be CREATED to the active system
-    for(auto entity: m_entitiesTobeAdded) {
-        Registry::AddEntityToSystems(entity);
+void Registry::RemoveComponent(int componentId, Entity entity) {
+    const auto entityId = entity.GetId();
+    if (!m_entityComponentSignatures[entityId].test(componentId)) {
+        return;
+    }
+
+    NotifyComponentRemoved(componentId, entity);
+
+#ifdef ECS_ARCHETYPE_STORAGE
+    m_archetypeStorage.Remove(componentId, entityId, m_entityComponentSignatures[entityId]);
+#else
+    if (m_owningGroupPerComponent[componentId]) {
+        LeaveOwningGroup(*m_owningGroupPerComponent[componentId], entityId);
+    }
+    m_componentTypePools[componentId]->RemoveEntityFromPool(entityId);
+#endif
+    m_entityComponentSignatures[entityId].set(componentId, false);
+}
+
+#ifndef ECS_ARCHETYPE_STORAGE
+void Registry::EnterOwningGroup(OwningGroupData& group, int entityId) {
+    // Sleeping entities stay out of the group until they wake up
+    if ((m_entityComponentSignatures[entityId] & group.owned) != group.owned || !m_entityIsActive[entityId]) {
+        return;
+    }
+    if (group.pools.front()->GetIndex(entityId) < group.size) {
+        return; // already in the group
+    }
+
+    // Swap the components of the entity to the end of the sorted prefix of every owned pool
+    for (auto pool: group.pools) {
+        pool->SwapIndexes(pool->GetIndex(entityId), group.size);
+    }
+    group.size++;
+}
+
+void Registry::LeaveOwningGroup(OwningGroupData& group, int entityId) {
+    if ((m_entityComponentSignatures[entityId] & group.owned) != group.owned) {
+        return;
+    }
+    if (group.pools.front()->GetIndex(entityId) >= group.size) {
+        return;
+    }
+
+    // Swap the components of the entity with the last ones of the prefix, and shrink it
+    group.size--;
+    for (auto pool: group.pools) {
+        pool->SwapIndexes(pool->GetIndex(entityId), group.size);
+    }
+}
+#endif
+
+void Registry::NotifyComponentAdded(int componentId, Entity entity) {
+    if (componentId < static_cast<int>(m_onComponentAdded.size())) {
+        for (auto& observer: m_onComponentAdded[componentId]) {
+            observer(entity);
+        }
+    }
+}
+
+void Registry::NotifyComponentRemoved(int componentId, Entity entity) {
+    if (componentId < static_cast<int>(m_onComponentRemoved.size())) {
+        for (auto& observer: m_onComponentRemoved[componentId]) {
+            observer(entity);
+        }
+    }
+}
+
+void Registry::ApplyCommandBuffers() {
+    auto& buffers = m_appliedBuffers;
+    buffers.clear();
+    for (auto& commandBuffer: m_commandBuffers) {
+        if (!commandBuffer.IsEmpty()) {
+            buffers.push_back(&commandBuffer);
+        }
+    }
+    if (!m_overflowCommandBuffer.IsEmpty()) {
+        buffers.push_back(&m_overflowCommandBuffer);
+    }
+    if (buffers.empty()) {
+        return;
+    }
+
+    // 1. Create the entities in the order of their spawner ids, whatever thread recorded them
+    auto& creations = m_creations;
+    creations.clear();
+    for (auto* buffer: buffers) {
+        for (int i = 0; i < static_cast<int>(buffer->m_spawnerIds.size()); i++) {
+            creations.push_back({ buffer->m_spawnerIds[i], static_cast<int>(creations.size()), buffer, i });
+        }
+        buffer->m_createdEntities.assign(buffer->m_spawnerIds.size(), Entity(-1));
+    }
+    // Same order as a stable sort by spawner, without its temporary buffer
+    std::sort(creations.begin(), creations.end(), [](const Creation& a, const Creation& b) {
+        return a.spawnerId != b.spawnerId ? a.spawnerId < b.spawnerId : a.order < b.order;
+    });
+    auto& createdEntities = m_spawnedEntities;
+    createdEntities.clear();
+    CreateEntities(static_cast<int>(creations.size()), createdEntities);
+    for (size_t i = 0; i < creations.size(); i++) {
+        creations[i].buffer->m_createdEntities[creations[i].index] = createdEntities[i];
+    }
+
+    // The entities instantiated from a prefab get its components, each run of consecutive
+    // entities of the same prefab (ex: the projectiles of one emitter) is copied in bulk
+    auto& instances = m_prefabInstances;
+    instances.clear();
+    for (size_t i = 0; i < creations.size(); i++) {
+        const Prefab* prefab = creations[i].buffer->m_prefabs[creations[i].index];
+        if (!prefab) {
+            continue;
+        }
+        instances.push_back(createdEntities[i]);
+        const bool isLastOfRun = i + 1 == creations.size() || creations[i + 1].buffer->m_prefabs[creations[i + 1].index] != prefab;
+        if (isLastOfRun) {
+            AddPrefabComponents(*prefab, instances);
+            instances.clear();
+        }
+    }
+
+    // 2. Groups, with the placeholders replaced by the created entities. Commands recorded against
+    // entities killed in the meantime are dropped
+    for (auto* buffer: buffers) {
+        for (auto& group: buffer->m_groups) {
+            const Entity entity = CommandBuffer::ResolveEntity(group.first, buffer->m_createdEntities);
+            if (IsAlive(entity)) {
+                GroupEntity(entity, group.second);
+            }
+        }
+    }
+
+    // 3. Component removals and additions, one component type at a time
+    auto& removals = m_componentRemovals;
+    removals.clear();
+    for (auto* buffer: buffers) {
+        for (auto& removal: buffer->m_removals) {
+            const Entity entity = CommandBuffer::ResolveEntity(removal.entity, buffer->m_createdEntities);
+            if (IsAlive(entity)) {
+                removals.push_back({ removal.componentId, entity });
+            }
+        }
+    }
+    std::sort(removals.begin(), removals.end(), [](const CommandBuffer::ComponentRemoval& a, const CommandBuffer::ComponentRemoval& b) {
+        return a.componentId != b.componentId ? a.componentId < b.componentId : a.entity.GetId() < b.entity.GetId();
+    });
+    for (auto& removal: removals) {
+        RemoveComponent(removal.componentId, removal.entity);
+    }
+
+    auto& additions = m_componentAdditions;
+    for (int componentId = 0; componentId < static_cast<int>(MAX_COMPONENTS); componentId++) {
+        additions.clear();
+        for (auto* buffer: buffers) {
+            if (componentId < static_cast<int>(buffer->m_additions.size()) && buffer->m_additions[componentId]) {
+                buffer->m_additions[componentId]->ResolvePlaceholders(buffer->m_createdEntities);
+                additions.push_back(buffer->m_additions[componentId].get());
+            }
+        }
+        if (!additions.empty()) {
+            additions.front()->ApplyAll(*this, additions);
+        }
+    }
+
+    // 4. Entities going to sleep or waking up
+    for (auto* buffer: buffers) {
+        for (auto& activeChange: buffer->m_activeChanges) {
+            const Entity entity = CommandBuffer::ResolveEntity(activeChange.first, buffer->m_createdEntities);
+            if (IsAlive(entity)) {
+                ApplyEntityActive(entity, activeChange.second);
+            }
+        }
     }
-    m_entitiesTobeAdded.clear();
 
-    // Process the entities that are waiting to be killed from the active systems
-    for(auto entity: m_entitiesToBeKilled) {
+    // 5. Kills, Update() sorts m_entitiesToBeKilled by entity id
+    for (auto* buffer: buffers) {
+        for (auto& kill: buffer->m_kills) {
+            const Entity entity = CommandBuffer::ResolveEntity(kill, buffer->m_createdEntities);
+            if (IsAlive(entity)) {
+                m_entitiesToBeKilled.push_back(entity);
+            }
+        }
+        buffer->Clear();
+    }
+}
 
-        Registry::RemoveEntityFromSystems(entity);
+void Registry::Update() {
+    // Apply everything recorded by the systems since the last update, the created entities join
+    // their systems right bellow with all of their components
+    ApplyCommandBuffers();
+
+    while (true) {
+        // processing the entitites that are waiting to be CREATED to the active system
+        for(auto entity: m_entitiesTobeAdded) {
+            // Entities put to sleep right away join their systems when they wake up
+            if (m_entityIsActive[entity.GetId()]) {
+                Registry::AddEntityToSystems(entity);
+            }
+        }
+        m_entitiesTobeAdded.clear();
 
-        // Clear the component signatures of that entity
-        m_entityComponentSignatures[entity.GetId()].reset();
+        if (m_entitiesToBeKilled.empty()) {
+            break;
+        }
 
-        // Remove the entity from the component pools
-        for (auto pool: m_componentTypePools) {
-            if (pool) {
-                pool->RemoveEntityFromPool(entity.GetId());
+        // Process the entities that are waiting to be killed from the active systems, in id order
+        std::sort(m_entitiesToBeKilled.begin(), m_entitiesToBeKilled.end());
+        m_entitiesToBeKilled.erase(std::unique(m_entitiesToBeKilled.begin(), m_entitiesToBeKilled.end()), m_entitiesToBeKilled.end());
+        for(auto entity: m_entitiesToBeKilled) {
+            // The same entity may have been killed through two handles, or through a stale one
+            if (!IsAlive(entity)) {
+                continue;
             }
+
+            RemoveEntity(entity);
         }
+        m_entitiesToBeKilled.clear();
+
+        // The observers of the removed components may have killed other entities (ex: the children
+        // of a killed parent, see HierarchySystem), they go in this same update and not a frame later
+        ApplyCommandBuffers();
+    }
+}
 
-        // Make the entity id to be available to be reused
-        m_freeIds.push_back(entity.GetId());
+void Registry::RemoveEntity(Entity entity) {
+    Registry::RemoveEntityFromSystems(entity);
 
-        // Remove any traces of that entity from the tag/group maps
-        RemoveEntityTag(entity);
-        RemoveEntityGroup(entity);
+    // Let the observers see the components one last time
+    const auto& signature = m_entityComponentSignatures[entity.GetId()];
+    for (int componentId = 0; componentId < static_cast<int>(m_onComponentRemoved.size()); componentId++) {
+        if (signature.test(componentId)) {
+            NotifyComponentRemoved(componentId, entity);
+        }
     }
+
+#ifndef ECS_ARCHETYPE_STORAGE
+    // Take the entity out of the sorted prefix of its owning groups, while its signature is intact
+    for (auto& group: m_owningGroups) {
+        LeaveOwningGroup(*group, entity.GetId());
+    }
+#endif
+
+    // Clear the component signatures of that entity
+    m_entityComponentSignatures[entity.GetId()].reset();
+
+    // Remove the entity from the component pools
+#ifdef ECS_ARCHETYPE_STORAGE
+    m_archetypeStorage.RemoveEntity(entity.GetId());
+#else
+    for (auto pool: m_componentTypePools) {
+        if (pool) {
+            pool->RemoveEntityFromPool(entity.GetId());
+        }
+    }
+#endif
+
+    // Remove any traces of that entity from the tag/group maps
+    RemoveEntityTag(entity);
+    RemoveEntityGroup(entity);
+
+    // Bump the generation so every handle still pointing to this entity is no longer alive,
+    // then make the entity id to be available to be reused
+    m_entityGenerations[entity.GetId()]++;
+    m_entityIsActive[entity.GetId()] = true;
+    m_freeIds.push_back(entity.GetId());
+}
+
+void Registry::Clear() {
+    m_entitiesTobeAdded.clear();
     m_entitiesToBeKilled.clear();
-}
\ No newline at end of file
+
+    std::vector<bool> isFree(m_numEntities, false);
+    for (int entityId: m_freeIds) {
+        isFree[entityId] = true;
+    }
+    for (int entityId = 0; entityId < m_numEntities; entityId++) {
+        if (!isFree[entityId]) {
+            RemoveEntity(GetEntity(entityId));
+        }
+    }
+
+    // Pending changes point to the entities removed above, the observers called while removing
+    // them may have recorded more (ex: kills of children)
+    for (auto& commandBuffer: m_commandBuffers) {
+        commandBuffer.Clear();
+    }
+    m_overflowCommandBuffer.Clear();
+
+    // Start over from id 0, the per entity vectors are resized again by the next creation.
+    // The generations are kept (RemoveEntity bumped them), so the handles taken before the clear
+    // stay dead when their id is used again.
+    m_numEntities = 0;
+    m_freeIds.clear();
+    m_entityComponentSignatures.clear();
+    m_entityIsActive.clear();
+    m_entitySleepTicks.clear();
+    tagPerEntity.clear();
+    groupsPerEntity.clear();
+    m_entitySystemSignatures.clear();
+}
@@ -10,17 +10,62 @@
 #include "../Logger/Logger.h"
 #include <deque>
 #include <iostream>
+#include <tuple>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
 
-const unsigned int MAX_COMPONENTS = 32;
+////////////////////////////////////////////////////////////////////////////////////
+// Component manifest
+////////////////////////////////////////////////////////////////////////////////////
+//// The component types are listed once in ComponentManifest (a ComponentList), so
+//// their ids and the number of components are known at compile time.
+////////////////////////////////////////////////////////////////////////////////////
+template <typename ...TComponents>
+struct ComponentList {
+    static constexpr unsigned int size = sizeof...(TComponents);
+};
+
+#include "../Components/ComponentManifest.h"
+
+const unsigned int MAX_COMPONENTS = ComponentManifest::size;
+const unsigned int MAX_GROUPS = 64;
+const unsigned int MAX_THREAD_SLOTS = 64;
 
 ////////////////////////////////////////////////////////////////////////////////////
 // Signature
 ////////////////////////////////////////////////////////////////////////////////////
 //// We use a bitset (1..0) to keep track of which components an entity has,
 //// and also helps keep track of which entities a system is interested in.
+//// It has one bit per registered component, past 64 components it spans several
+//// words that the signature compares walk together.
 ////////////////////////////////////////////////////////////////////////////////////
 typedef std::bitset<MAX_COMPONENTS> Signature;
 
+////////////////////////////////////////////////////////////////////////////////////
+// Tags and Groups
+////////////////////////////////////////////////////////////////////////////////////
+//// Tag and group names are interned into small integer ids (Registry::GetTagId and
+//// Registry::GetGroupId), each entity keeps a tag id and a bitmask of its group ids.
+////////////////////////////////////////////////////////////////////////////////////
+typedef int TagId;
+typedef int GroupId;
+typedef std::bitset<MAX_GROUPS> GroupMask;
+
+////////////////////////////////////////////////////////////////////////////////////
+// Component storage backend
+////////////////////////////////////////////////////////////////////////////////////
+//// By default every component type lives in its own sparse set Pool<T>.
+//// Building with ECS_ARCHETYPE_STORAGE (make build STORAGE=archetype) stores the
+//// entities grouped by exact Signature in chunks of SoA columns instead.
+////////////////////////////////////////////////////////////////////////////////////
+#ifdef ECS_ARCHETYPE_STORAGE
+#include "./Archetype.h"
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////////
 // Entity
 ////////////////////////////////////////////////////////////////////////////////////
@@ -28,27 +73,44 @@ typedef std::bitset<MAX_COMPONENTS> Signature;
 ////////////////////////////////////////////////////////////////////////////////////
 class Entity {
     private:
+        // Index of the entity in the registry arrays, reused after the entity is killed
         int m_id;
+        // Bumped every time the id is freed, so an old handle to a reused id is not alive anymore
+        unsigned int m_generation;
     
     public:
-        Entity(int id): m_id(id) {};
+        Entity(int id, unsigned int generation = 0): m_id(id), m_generation(generation), m_registry(nullptr) {};
         Entity(const Entity& entity) = default;
 
         int GetId() const;
+        unsigned int GetGeneration() const;
+        // False once the entity was killed (after the next Registry::Update), O(1)
+        bool IsAlive() const;
         void Kill();
 
+        // An inactive (sleeping) entity keeps its components, tags and groups but is left out of the
+        // systems, views and owning groups until it is activated again.
+        // Like Kill(), the change is applied at the next Registry::Update().
+        void SetActive(bool isActive);
+        bool IsActive() const;
+
         // Manage entity tags and groups
+        // The id overloads are O(1), the string ones look the name up first (used by Lua and level files)
 		void Tag(const std::string& tag);
+		void Tag(TagId tag);
     	bool HasTag(const std::string& tag) const;
+    	bool HasTag(TagId tag) const;
     	void Group(const std::string& group);
+    	void Group(GroupId group);
     	bool BelongsToGroup(const std::string& group) const;
+    	bool BelongsToGroup(GroupId group) const;
 
         Entity& operator =(const Entity& other) = default;
         // Overloading the operator of == when using with Entity instances
-        bool operator == (const Entity& other) const { return m_id == other.m_id; }
-        bool operator !=(const Entity& other) const { return m_id != other.m_id; }
-        bool operator >(const Entity& other) const { return m_id > other.m_id; }
-        bool operator <(const Entity& other) const { return m_id < other.m_id; }
+        bool operator == (const Entity& other) const { return m_id == other.m_id && m_generation == other.m_generation; }
+        bool operator !=(const Entity& other) const { return !(*this == other); }
+        bool operator >(const Entity& other) const { return other < *this; }
+        bool operator <(const Entity& other) const { return m_id != other.m_id ? m_id < other.m_id : m_generation < other.m_generation; }
 
         template <typename TComponent, typename ...TArgs> void AddComponent(TArgs&& ...args);
         template <typename TComponent> void RemoveComponent();
@@ -57,7 +119,7 @@ class Entity {
 
         // Hold a pointer to the entity's owner register
         // Just a forward declaration because the actuall class is bellow in file.
-        class Registry* m_registry;
+        class Registry* m_registry = nullptr;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////
@@ -66,19 +128,36 @@ class Entity {
 //// 
 ////////////////////////////////////////////////////////////////////////////////////
 
-struct IComponent {
-    protected:
-        static int m_nextId;
+// Position of TComponent in a ComponentList, or the size of the list if it is not there
+template <typename TComponent, typename TList>
+struct ComponentIndex;
+
+template <typename TComponent>
+struct ComponentIndex<TComponent, ComponentList<>> {
+    static constexpr int value = 0;
+};
+
+template <typename TComponent, typename ...TOthers>
+struct ComponentIndex<TComponent, ComponentList<TComponent, TOthers...>> {
+    static constexpr int value = 0;
+};
+
+template <typename TComponent, typename TFirst, typename ...TOthers>
+struct ComponentIndex<TComponent, ComponentList<TFirst, TOthers...>> {
+    static constexpr int value = 1 + ComponentIndex<TComponent, ComponentList<TOthers...>>::value;
 };
 
-// Used to assign a unique id to a component type
+// Used to get the unique id of a component type, its index in the ComponentManifest
 template <typename TComponent>
-class Component: public IComponent {
+class Component {
+    private:
+        static constexpr int m_id = ComponentIndex<std::remove_const_t<TComponent>, ComponentManifest>::value;
+        static_assert(m_id < static_cast<int>(MAX_COMPONENTS), "Component type missing from ComponentManifest.h");
+
     public:
-        // Returns the unique id of the Component<T>
-        static int GetId() {
-            static auto id = m_nextId++;
-            return id;
+        // Returns the unique id of the Component<T>, const T shares the id of T
+        static constexpr int GetId() {
+            return m_id;
         }
 };
 
@@ -92,23 +171,56 @@ class System {
         Signature m_componentSignature;
         std::vector<Entity> m_entities;
 
+        // Components the system reads and writes, used by the SystemScheduler to decide which
+        // systems can run at the same time. Required components are read by default.
+        Signature m_readSignature;
+        Signature m_writeSignature;
+
+        // Exclusive systems run alone (they create entities, emit events, call Lua, ...)
+        bool m_isExclusive = false;
+
+        // Index of each entity inside m_entities (or -1), so membership is O(1)
+        // [Vector index = entity id]
+        std::vector<int> m_entityIndexes;
+
     public:
         System() = default;
         ~System() = default;
 
+        // Both O(1), removal swaps the last entity into the hole so the order is not kept
         void AddEntityToSystem(Entity entity);
         void RemoveEntityFromSystem(Entity entity);
-        std::vector<Entity> GetSystemEntities() const;
+        bool HasEntity(Entity entity) const;
+
+        // Non-owning view of the entities of this system, nothing is copied.
+        // It is safe to iterate while creating or killing entities: those changes are buffered
+        // by the Registry and only touch this vector during Registry::Update(), which must never
+        // be called from inside a system loop.
+        const std::vector<Entity>& GetSystemEntities() const;
         const Signature& GetComponentSignature() const;
 
         // Define the component type T that entities must have to be considered by the system
         template <typename TComponent> void RequireComponent();
+
+        // Declare the component access of the system for the SystemScheduler.
+        // Two systems conflict when one writes a component the other reads or writes.
+        template <typename TComponent> void ReadsComponent();
+        template <typename TComponent> void WritesComponent();
+        void RequireExclusiveAccess();
+
+        const Signature& GetReadSignature() const;
+        const Signature& GetWriteSignature() const;
+        bool IsExclusive() const;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
 // Pool
 ///////////////////////////////////////////////////////////////////////////////////////////////
-//// A Pool is just a vector (continuous data) of objects of type T (generic) 
+//// A Pool is a sparse set of objects of type T (generic): the components live packed in a
+///  dense vector (continuous data) and a paged sparse array maps entity ids to dense indexes,
+///  so Get/Has/Set/Remove are all O(1) without hashing.
+///  Each component also has a change tick, stamped by Set and GetMutable, so the systems can
+///  find the components written since their last run (see Registry::AdvanceChangeTick).
 ///  this is a template class, we implement that in .h file
 ///  IPool is just a trick to generic classes, so in the register we can point to IPool and
 ///  this way we will keep Pool generic.
@@ -117,96 +229,398 @@ class IPool {
     public: 
         virtual ~IPool() {}
         virtual void RemoveEntityFromPool(int entityId) = 0;
+        // Dense index of the component of an entity, the entity must have the component
+        virtual int GetIndex(int entityId) const = 0;
+        // Swaps two components of the dense array, used by the owning groups to sort the pool
+        virtual void SwapIndexes(int indexA, int indexB) = 0;
+        // Stamps changeTick on the component of an entity if it was written after sinceTick,
+        // used when the entity wakes up (see Registry::ApplyEntityActive)
+        virtual void RestampIfChangedAfter(int entityId, unsigned int sinceTick, unsigned int changeTick) = 0;
 };
 
 template <typename T>
 class Pool: public IPool {
     private:
 
-        // We keep track of the vector of entities and the current number of elements in each pool
+        // Dense arrays, data[i] is the component that belongs to the entity m_entityIds[i].
+        // Both vectors are always packed, removal swaps the last element into the hole.
         std::vector<T> data;
-        int m_size;
+        std::vector<int> m_entityIds;
+        // Change tick of data[i], the tick of the Registry when it was last added or written
+        std::vector<unsigned int> m_changeTicks;
+
+        // Sparse array indexed by entity id that stores the dense index of the entity (or INVALID_INDEX).
+        // It is split in fixed size pages allocated on demand, so a pool with only a few components
+        // for high entity ids does not pay for the whole id range.
+        static constexpr int SPARSE_PAGE_BITS = 12;
+        static constexpr int SPARSE_PAGE_SIZE = 1 << SPARSE_PAGE_BITS;
+        static constexpr int INVALID_INDEX = -1;
+        std::vector<std::vector<int>> m_sparsePages;
+
+        // Returns the sparse slot of an entity id, or nullptr if its page was never allocated
+        const int* FindSparseSlot(int entityId) const {
+            const unsigned int page = static_cast<unsigned int>(entityId) >> SPARSE_PAGE_BITS;
+            if (page >= m_sparsePages.size() || m_sparsePages[page].empty()) {
+                return nullptr;
+            }
+            return &m_sparsePages[page][entityId & (SPARSE_PAGE_SIZE - 1)];
+        }
 
-        // Maps to keep track of entity ids per index so the vector is always packed
-        std::unordered_map<int, int> m_entityIdToIndex;
-        std::unordered_map<int, int> m_indexToEntityId;
+        // Returns the sparse slot of an entity id, allocating its page when needed
+        int& GetSparseSlot(int entityId) {
+            const unsigned int page = static_cast<unsigned int>(entityId) >> SPARSE_PAGE_BITS;
+            if (page >= m_sparsePages.size()) {
+                m_sparsePages.resize(page + 1);
+            }
+            if (m_sparsePages[page].empty()) {
+                m_sparsePages[page].assign(SPARSE_PAGE_SIZE, INVALID_INDEX);
+            }
+            return m_sparsePages[page][entityId & (SPARSE_PAGE_SIZE - 1)];
+        }
 
     public:
         Pool(int capacity = 100) {
-            m_size = 0;
-            data.resize(capacity); 
+            data.reserve(capacity);
+            m_entityIds.reserve(capacity);
+            m_changeTicks.reserve(capacity);
         };
 
         virtual ~Pool() = default;
 
-        bool IsEmpty() const { return m_size == 0; };
+        bool IsEmpty() const { return data.empty(); };
+
+        int GetSize() const { return static_cast<int>(data.size()); };
 
-        int GetSize() const { return m_size; };
+        void Resize(int n) {
+            data.reserve(n);
+            m_entityIds.reserve(n);
+            m_changeTicks.reserve(n);
+        };
 
-        void Resize(int n) { data.resize(n); };
+        // Makes room for n more components, growing geometrically like push_back does
+        void ReserveAdditional(int n) {
+            const size_t needed = data.size() + n;
+            if (needed > data.capacity()) {
+                Resize(static_cast<int>(std::max(needed, data.capacity() * 2)));
+            }
+        };
 
         void Clear() { 
             data.clear();
-            m_size = 0;
+            m_entityIds.clear();
+            m_changeTicks.clear();
+            m_sparsePages.clear();
         };
 
-        // Adding a new pool of component type
-        void Add(T object) {
-            data.push_back(object);
+        bool Has(int entityId) const {
+            const int* slot = FindSparseSlot(entityId);
+            return slot && *slot != INVALID_INDEX;
         };
 
-
-        void Set(int entityId, T object) {
-            if (m_entityIdToIndex.find(entityId) != m_entityIdToIndex.end()){
+        // Constructs the component straight in the dense array, forwarding args to its constructor
+        template <typename ...TArgs>
+        T& Emplace(int entityId, unsigned int changeTick, TArgs&& ...args) {
+            int& index = GetSparseSlot(entityId);
+            if (index != INVALID_INDEX) {
                 // if the element already exists, simply replace the component object
-                int index = m_entityIdToIndex[entityId];
-                data[index] = object;
-
+                data[index] = T(std::forward<TArgs>(args)...);
+                m_changeTicks[index] = changeTick;
             } else {
-                int index = m_size;
-                m_entityIdToIndex.emplace(entityId, index);
-                m_indexToEntityId.emplace(index, entityId);
-                if ((int)index >= (int)data.capacity()) {
-                    // If necessary we double our data capacity
-                    data.resize(m_size * 2);
-                }
-                data[index] = object;
-                m_size++;
+                index = static_cast<int>(data.size());
+                m_entityIds.push_back(entityId);
+                data.emplace_back(std::forward<TArgs>(args)...);
+                m_changeTicks.push_back(changeTick);
             }
-            
+            return data[index];
         };
 
-        void Remove(int entityId) {
-            // Copy the last element to the deleted position to keep the array packed
-            int indexOfRemoved = m_entityIdToIndex[entityId];
-            int indexOfLast = m_size - 1;
-            data[indexOfRemoved] = data[indexOfLast];
-
-            //Update the index-entity maps to point to the correct element
-            int entityIdOfLastElement = m_indexToEntityId[indexOfLast];
-            m_entityIdToIndex[entityIdOfLastElement] = indexOfRemoved;
-            m_indexToEntityId[indexOfRemoved] = entityIdOfLastElement;
+        void Set(int entityId, T object, unsigned int changeTick) {
+            Emplace(entityId, changeTick, std::move(object));
+        };
 
-            m_entityIdToIndex.erase(entityId);
-            m_indexToEntityId.erase(indexOfLast);
+        void Remove(int entityId) {
+            int& indexOfRemoved = GetSparseSlot(entityId);
+            const int indexOfLast = static_cast<int>(data.size()) - 1;
+            const int entityIdOfLast = m_entityIds[indexOfLast];
+
+            // Move the last element to the deleted position to keep the array packed
+            if (indexOfRemoved != indexOfLast) {
+                data[indexOfRemoved] = std::move(data[indexOfLast]);
+                m_entityIds[indexOfRemoved] = entityIdOfLast;
+                m_changeTicks[indexOfRemoved] = m_changeTicks[indexOfLast];
+                GetSparseSlot(entityIdOfLast) = indexOfRemoved;
+            }
 
-            m_size--;
+            // The slot of the removed entity is updated last, in case it was also the last element
+            indexOfRemoved = INVALID_INDEX;
+            data.pop_back();
+            m_entityIds.pop_back();
+            m_changeTicks.pop_back();
         };
 
         void RemoveEntityFromPool (int entityId) override {
-            if (m_entityIdToIndex.find(entityId) != m_entityIdToIndex.end()) {
+            if (Has(entityId)) {
                 Remove(entityId);
             }
         }
 
+        int GetIndex(int entityId) const override {
+            return *FindSparseSlot(entityId);
+        }
+
+        void SwapIndexes(int indexA, int indexB) override {
+            if (indexA == indexB) {
+                return;
+            }
+            std::swap(data[indexA], data[indexB]);
+            std::swap(m_entityIds[indexA], m_entityIds[indexB]);
+            std::swap(m_changeTicks[indexA], m_changeTicks[indexB]);
+            GetSparseSlot(m_entityIds[indexA]) = indexA;
+            GetSparseSlot(m_entityIds[indexB]) = indexB;
+        }
+
+        // Does not touch the change tick, use it to read the component
         T& Get(int entityId){
-            int index = m_entityIdToIndex[entityId];
-            return static_cast<T&>(data[index]);
+            return data[*FindSparseSlot(entityId)];
+        };
+
+        // Get to write the component, stamping its change tick
+        T& GetMutable(int entityId, unsigned int changeTick) {
+            const int index = *FindSparseSlot(entityId);
+            m_changeTicks[index] = changeTick;
+            return data[index];
+        };
+
+        unsigned int GetChangeTick(int entityId) const {
+            return m_changeTicks[*FindSparseSlot(entityId)];
+        };
+
+        void RestampIfChangedAfter(int entityId, unsigned int sinceTick, unsigned int changeTick) override {
+            const int* slot = FindSparseSlot(entityId);
+            if (slot && *slot != INVALID_INDEX && m_changeTicks[*slot] > sinceTick) {
+                m_changeTicks[*slot] = changeTick;
+            }
+        };
+
+        // Change tick of the component stored at a dense index
+        unsigned int GetChangeTickAt(unsigned int index) const {
+            return m_changeTicks[index];
+        };
+
+        // Entity id that owns the component stored at a dense index
+        int GetEntityId(unsigned int index) const {
+            return m_entityIds[index];
         };
 
         T& operator [](unsigned int index) {
             return data[index];
         };
+
+        // Same as GetMutable(), by dense index
+        T& GetMutableAt(unsigned int index, unsigned int changeTick) {
+            m_changeTicks[index] = changeTick;
+            return data[index];
+        };
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// Owning groups
+///////////////////////////////////////////////////////////////////////////////////////////////
+//// An owning group takes over the pools of a set of components (ex: Transform and Sprite) and
+///  keeps them partitioned: the entities that have all of them sit in the first `size` slots of
+///  every owned pool, in the same order. Iterating the group is then a linear walk over
+///  parallel arrays without any membership test (see OwningGroup and Registry::CreateOwningGroup).
+///  Entities are swapped in and out of that prefix when they gain or lose an owned component,
+///  and when they go to sleep or wake up (Entity::SetActive).
+///  A pool can be owned by one group only.
+///  With ECS_ARCHETYPE_STORAGE the archetype chunks are already laid out this way, and an
+///  OwningGroup is a plain ComponentView.
+///////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef ECS_ARCHETYPE_STORAGE
+struct OwningGroupData {
+    Signature owned;
+    std::vector<IPool*> pools;
+    // Number of entities that have all the owned components, the length of the sorted prefix
+    int size = 0;
+};
+#endif
+
+// The query view returned by Registry::View<...>() is defined after the Registry
+template <typename ...TComponents> class ComponentView;
+class Prefab;
+#ifndef ECS_ARCHETYPE_STORAGE
+template <typename ...TComponents> class OwningGroup;
+#else
+template <typename ...TComponents> using OwningGroup = ComponentView<TComponents...>;
+#endif
+
+// Callback registered with Registry::OnComponentAdded / Registry::OnComponentRemoved
+typedef std::function<void(Entity)> ComponentObserver;
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// CommandBuffer
+///////////////////////////////////////////////////////////////////////////////////////////////
+//// Records entity creation and destruction and component changes to apply them later, at the
+///  next Registry::Update(). Every thread has its own buffer (Registry::GetCommandBuffer), so
+///  systems running on worker threads can spawn and kill entities without locking.
+///  The buffers are applied in a fixed order that does not depend on the threads:
+///    1. created entities, sorted by the id of the entity that spawned them, with the
+///       components of their prefab when they were instantiated (CommandBuffer::Instantiate)
+///    2. groups of the created entities
+///    3. removed components and then added components, one component type at a time
+///       sorted by entity id, so each pool is filled in one go
+///    4. entities activated or deactivated (SetActive)
+///    5. killed entities
+///  Commands about the same entity should come from the same thread in a frame, and commands
+///  about entities that are not alive anymore when the buffer is applied are dropped.
+///////////////////////////////////////////////////////////////////////////////////////////////
+class IComponentCommands {
+    public:
+        virtual ~IComponentCommands() = default;
+        virtual void Clear() = 0;
+        virtual void ResolvePlaceholders(const std::vector<Entity>& createdEntities) = 0;
+        // Adds the components of this list and of the lists of the same type in the other buffers
+        virtual void ApplyAll(Registry& registry, const std::vector<IComponentCommands*>& lists) = 0;
+};
+
+// Components of type T added by one buffer
+template <typename T>
+class ComponentCommands: public IComponentCommands {
+    private:
+        // Merged additions of every buffer, used by ApplyAll. Cleared, not freed, between frames.
+        std::vector<std::pair<Entity, T*>> m_sortedAdditions;
+        std::vector<Entity> m_sortedEntities;
+        std::vector<T> m_sortedComponents;
+
+    public:
+        std::vector<Entity> m_entities;
+        std::vector<T> m_components;
+
+        void Clear() override {
+            m_entities.clear();
+            m_components.clear();
+        }
+        void ResolvePlaceholders(const std::vector<Entity>& createdEntities) override;
+        void ApplyAll(Registry& registry, const std::vector<IComponentCommands*>& lists) override;
+};
+
+class alignas(64) CommandBuffer {
+    private:
+        friend class Registry;
+
+        struct ComponentRemoval {
+            int componentId;
+            Entity entity;
+        };
+
+        // Spawner entity id of each created entity, the index is the placeholder index
+        std::vector<int> m_spawnerIds;
+        // Entity created for each placeholder, filled when the buffer is applied
+        std::vector<Entity> m_createdEntities;
+        std::vector<std::pair<Entity, GroupId>> m_groups;
+        std::vector<ComponentRemoval> m_removals;
+        // [Vector index = component type id]
+        std::vector<std::unique_ptr<IComponentCommands>> m_additions;
+        std::vector<std::pair<Entity, bool>> m_activeChanges;
+        std::vector<Entity> m_kills;
+        bool m_isEmpty = true;
+
+        // Prefab of each created entity (nullptr for CreateEntity), the index is the placeholder index
+        std::vector<const Prefab*> m_prefabs;
+
+        // Placeholder ids are negative, -1 is kept free
+        static int ToPlaceholderId(int index) { return -2 - index; }
+        static int ToPlaceholderIndex(int placeholderId) { return -2 - placeholderId; }
+
+    public:
+        // Resolves a placeholder to the entity created for it, other entities are returned as is
+        static Entity ResolveEntity(Entity entity, const std::vector<Entity>& createdEntities) {
+            return entity.GetId() < -1 ? createdEntities[ToPlaceholderIndex(entity.GetId())] : entity;
+        }
+
+        // Records the creation of an entity on behalf of spawner (ex: the projectile emitter).
+        // Returns a placeholder that can only be used with the commands of this buffer, the real
+        // entity is created at the next Registry::Update().
+        Entity CreateEntity(Entity spawner);
+        // Same as CreateEntity, the entity starts with the components and groups of the prefab.
+        // The prefab must stay alive until the buffer is applied. Components added to the
+        // placeholder replace the ones of the prefab.
+        Entity Instantiate(Entity spawner, const Prefab& prefab);
+        void SetEntityActive(Entity entity, bool isActive);
+        void KillEntity(Entity entity);
+        void GroupEntity(Entity entity, GroupId group);
+
+        template <typename TComponent, typename ...TArgs> void AddComponent(Entity entity, TArgs&& ...args);
+        template <typename TComponent> void RemoveComponent(Entity entity);
+
+        bool IsEmpty() const;
+        void Clear();
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// Prefab
+///////////////////////////////////////////////////////////////////////////////////////////////
+//// A template entity: its signature, one copy of each of its components and its groups.
+///  Registry::Instantiate(prefab, count) creates count entities at once and copies the
+///  components in bulk, one pool (or one archetype) at a time, instead of adding them to each
+///  entity one by one. The instances are plain entities, changing the prefab afterwards does
+///  not touch them.
+///  Prefabs are built in code (ex: the projectiles) or read from the `prefabs` table of the
+///  level files into the named prefabs of the Registry (Registry::AddPrefab).
+///////////////////////////////////////////////////////////////////////////////////////////////
+class IPrefabComponent {
+    public:
+        virtual ~IPrefabComponent() = default;
+#ifdef ECS_ARCHETYPE_STORAGE
+        virtual ComponentPrototype GetPrototype() const = 0;
+#else
+        // Appends a copy of the component to the pool for each entity
+        virtual void AddCopies(Registry& registry, const std::vector<Entity>& entities) const = 0;
+#endif
+};
+
+template <typename T>
+class PrefabComponent: public IPrefabComponent {
+    public:
+        T m_component;
+
+        template <typename ...TArgs>
+        PrefabComponent(TArgs&& ...args): m_component(std::forward<TArgs>(args)...) {}
+
+#ifdef ECS_ARCHETYPE_STORAGE
+        ComponentPrototype GetPrototype() const override {
+            return { Component<T>::GetId(), GetComponentTypeInfo<T>(), &m_component };
+        }
+#else
+        void AddCopies(Registry& registry, const std::vector<Entity>& entities) const override;
+#endif
+};
+
+class Prefab {
+    private:
+        friend class Registry;
+
+        Signature m_signature;
+        // [Array index = component type id], nullptr for the components the prefab does not have
+        std::array<std::unique_ptr<IPrefabComponent>, MAX_COMPONENTS> m_components;
+        std::vector<GroupId> m_groups;
+
+    public:
+        Prefab() = default;
+        Prefab(Prefab&& other) = default;
+        Prefab& operator =(Prefab&& other) = default;
+
+        // Same as Entity::AddComponent, replaces the component if the prefab already has it
+        template <typename TComponent, typename ...TArgs> void AddComponent(TArgs&& ...args);
+        template <typename TComponent> void RemoveComponent();
+        template <typename TComponent> bool HasComponent() const;
+        // To tweak a component before instantiating the prefab
+        template <typename TComponent> TComponent& GetComponent() const;
+
+        void Group(GroupId group);
+        void Group(const std::string& group);
+
+        const Signature& GetSignature() const;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
@@ -220,30 +634,141 @@ class Registry {
         int m_numEntities = 0;
 
         // Works like a buffer, entities awaiting creation and destruction in the next Registry update();
-        std::set<Entity> m_entitiesTobeAdded;
-        std::set<Entity> m_entitiesToBeKilled;
-
-        // Entity tags (one tag name per entity)
-        std::unordered_map<std::string, Entity> entityPerTag;
-        std::unordered_map<int, std::string> tagPerEntity;
-
-        // Entity groups (a set of entities per groupname)
-        std::unordered_map<std::string, std::set<Entity>> entitiesPerGroup;
-        std::unordered_map<int, std::string> groupPerEntity;
-
+        // Ids are only freed by Update(), so an entity can not be waiting twice to be added.
+        std::vector<Entity> m_entitiesTobeAdded;
+        // Sorted by entity id and made unique by Update() before it is processed
+        std::vector<Entity> m_entitiesToBeKilled;
+
+        // Command buffer of each thread slot, applied by Update(). KillEntity goes through them too.
+        std::array<CommandBuffer, MAX_THREAD_SLOTS> m_commandBuffers;
+
+        // Shared by the threads that got no slot (more than MAX_THREAD_SLOTS threads alive)
+        CommandBuffer m_overflowCommandBuffer;
+        std::mutex m_overflowCommandBufferMutex;
+
+        // Scratch of ApplyCommandBuffers(), cleared and not freed so the frames do not allocate
+        struct Creation {
+            int spawnerId;
+            // Position in the buffers, keeps the recording order between creations of one spawner
+            int order;
+            CommandBuffer* buffer;
+            int index;
+        };
+        std::vector<CommandBuffer*> m_appliedBuffers;
+        std::vector<Creation> m_creations;
+        std::vector<Entity> m_spawnedEntities;
+        std::vector<Entity> m_prefabInstances;
+        std::vector<CommandBuffer::ComponentRemoval> m_componentRemovals;
+        std::vector<IComponentCommands*> m_componentAdditions;
+
+        void ApplyCommandBuffers();
+
+        // Appends n new entities to entities, see CreateEntities(int)
+        void CreateEntities(int n, std::vector<Entity>& entities);
+
+        // Removes a killed entity from its systems, owning groups, pools, tags and groups and frees its id
+        void RemoveEntity(Entity entity);
+
+        // Writes and restores the entities, ids, tags, groups and components (see Snapshot)
+        friend class Snapshot;
+
+        // Named prefabs, see AddPrefab()
+        std::unordered_map<std::string, Prefab> m_prefabs;
+
+        // Copies the components and groups of a prefab to entities that have no components yet
+        void AddPrefabComponents(const Prefab& prefab, const std::vector<Entity>& entities);
+
+#ifndef ECS_ARCHETYPE_STORAGE
+        // Appends a copy of the component to the pool for each entity, the entities must not have it.
+        // Does not call the observers nor enter the owning groups, AddPrefabComponents does.
+        template <typename TComponent> void AddComponentCopies(const std::vector<Entity>& entities, const TComponent& component);
+        template <typename TComponent> friend class PrefabComponent;
+#endif
+
+        // Type erased RemoveComponent, does nothing if the entity does not have the component
+        void RemoveComponent(int componentId, Entity entity);
+
+        // Interned tag and group names, shared by every registry
+        static std::unordered_map<std::string, TagId> m_tagIds;
+        static std::unordered_map<std::string, GroupId> m_groupIds;
+
+        // Entity tags (one tag per entity)
+        // [tagPerEntity index = entity id, value = tag id or -1]
+        std::unordered_map<TagId, Entity> entityPerTag;
+        std::vector<TagId> tagPerEntity;
+
+        // Entity groups (a set of entities per group, a bitmask of groups per entity)
+        // [entitiesPerGroup index = group id] [groupsPerEntity index = entity id]
+        std::vector<std::set<Entity>> entitiesPerGroup;
+        std::vector<GroupMask> groupsPerEntity;
+
+#ifdef ECS_ARCHETYPE_STORAGE
+        // Archetype chunks holding the components of every entity, grouped by signature
+        ArchetypeStorage m_archetypeStorage;
+#else
         // Vector of component pools, each pool contains all the data for a certain component type
         // [Vector index = component type id]
         // [Pool index = entity id]
         std::vector<std::shared_ptr<IPool>> m_componentTypePools;
 
+        template <typename TComponent> Pool<TComponent>* GetOrCreateComponentPool();
+
+        // Owning groups, and the group that owns the pool of each component (or nullptr)
+        // [Array index = component type id]
+        std::vector<std::unique_ptr<OwningGroupData>> m_owningGroups;
+        std::array<OwningGroupData*, MAX_COMPONENTS> m_owningGroupPerComponent{};
+
+        // Move an entity into the sorted prefix of the group when it has all the owned components,
+        // and out of it before it loses one of them
+        void EnterOwningGroup(OwningGroupData& group, int entityId);
+        void LeaveOwningGroup(OwningGroupData& group, int entityId);
+#endif
+
         // Vector of component signatures
         // The signature lets us know which components are turned on for an entity
         // [Vector index = entity id]
         std::vector<Signature> m_entityComponentSignatures;
 
+        // Current generation of each entity id, a handle is alive while its generation matches
+        // [Vector index = entity id]
+        std::vector<unsigned int> m_entityGenerations;
+
+        // False while the entity sleeps, see Entity::SetActive
+        // [Vector index = entity id]
+        std::vector<bool> m_entityIsActive;
+
+        // Tick before an entity went to sleep. Views skip sleeping entities, so the components written
+        // while it slept are stamped again when it wakes up for the systems to see them changed.
+        // [Vector index = entity id]
+        std::vector<unsigned int> m_entitySleepTicks;
+
+        // Takes the entity out of (or back into) its systems and owning groups
+        void ApplyEntityActive(Entity entity, bool isActive);
+
+        // Tick stamped on the components written now, see AdvanceChangeTick()
+        std::atomic<unsigned int> m_changeTick{ 1 };
+
+        // Observers called when a component is added to / removed from an entity
+        // [Vector index = component type id]
+        std::vector<std::vector<ComponentObserver>> m_onComponentAdded;
+        std::vector<std::vector<ComponentObserver>> m_onComponentRemoved;
+
+        void NotifyComponentAdded(int componentId, Entity entity);
+        void NotifyComponentRemoved(int componentId, Entity entity);
+
         // Keep track of all systems
         std::unordered_map<std::type_index, std::shared_ptr<System>> m_systems;
 
+        // Cache of the systems interested in each entity signature seen so far.
+        // It is rebuilt lazily, and cleared whenever a system is added or removed.
+        std::unordered_map<Signature, std::vector<System*>> m_systemsPerSignature;
+
+        // Signature each entity had when it was added to its systems, used to route its removal
+        // [Vector index = entity id]
+        std::vector<Signature> m_entitySystemSignatures;
+
+        const std::vector<System*>& GetInterestedSystems(const Signature& entitySignature);
+
         // List of available free entity id's that were previously removed
         std::deque<int> m_freeIds;
 
@@ -259,17 +784,94 @@ class Registry {
 
         //##### Entity Managment ####################################################################
         Entity CreateEntity();
+        // Creates n entities at once, reusing free ids first and then appending new ids contiguously
+        std::vector<Entity> CreateEntities(int n);
+        // Thread safe, the entity is only removed in the next Registry::Update()
         void KillEntity(Entity entity);
 
+        // Kills every entity right away and starts the ids over from 0, discarding the pending
+        // command buffers. The handles kept from before are dead, also once their ids are used
+        // again. Must not be called while the systems run.
+        void Clear();
+
+        // Thread safe, the entity sleeps (or wakes up) at the next Registry::Update()
+        void SetEntityActive(Entity entity, bool isActive);
+
+        // True for alive entities that are not sleeping
+        bool IsActive(Entity entity) const {
+            return IsAlive(entity) && m_entityIsActive[entity.GetId()];
+        }
+
+        // Same without the alive check, used by the views to skip the sleeping entities
+        bool IsEntityActive(int entityId) const {
+            return m_entityIsActive[entityId];
+        }
+
+        // Command buffer of the calling thread, applied at the next Registry::Update()
+        CommandBuffer& GetCommandBuffer();
+
+        //##### Prefabs #############################################################################
+
+        // Creates count entities (like CreateEntities) with the components and groups of the prefab,
+        // every component type is copied to all of them at once
+        std::vector<Entity> Instantiate(const Prefab& prefab, int count = 1);
+
+        // Named prefabs (ex: the ones of the level files). AddPrefab returns an empty prefab to fill,
+        // replacing the one with the same name. GetPrefab returns nullptr if there is none.
+        Prefab& AddPrefab(const std::string& name);
+        const Prefab* GetPrefab(const std::string& name) const;
+
+        // A handle is alive from its creation until the Registry::Update() that processes its kill.
+        // Handles kept after that (in events, scripts, ...) are dead even if their id was reused.
+        bool IsAlive(Entity entity) const {
+            const auto entityId = entity.GetId();
+            return entityId >= 0 && entityId < static_cast<int>(m_entityGenerations.size()) && m_entityGenerations[entityId] == entity.GetGeneration();
+        }
+
+        // Component types of an alive entity
+        const Signature& GetEntitySignature(Entity entity) const {
+            return m_entityComponentSignatures[entity.GetId()];
+        }
+
+        // Tag of an alive entity, -1 without a tag
+        TagId GetEntityTag(Entity entity) const {
+            return tagPerEntity[entity.GetId()];
+        }
+
+        // Groups of an alive entity
+        const GroupMask& GetEntityGroups(Entity entity) const {
+            return groupsPerEntity[entity.GetId()];
+        }
+
+        // Handle of the entity that currently uses an id
+        Entity GetEntity(int entityId) {
+            Entity entity(entityId, m_entityGenerations[entityId]);
+            entity.m_registry = this;
+            return entity;
+        }
+
+        // Slot of the calling thread in [0, MAX_THREAD_SLOTS), or -1 when all of them are taken.
+        // Slots are handed out on first use and given back when the thread exits.
+        static int GetThreadSlot();
+
+        // Interning of tag and group names, returns the same id for the same name.
+        // Systems should look their ids up once (ex: in the constructor) and use the id overloads.
+		static TagId GetTagId(const std::string& tag);
+		static GroupId GetGroupId(const std::string& group);
+
         // Tag management
-		void TagEntity(Entity entity, const std::string& tag);
-		bool EntityHasTag(Entity entity, const std::string& tag) const;
+		void TagEntity(Entity entity, TagId tag);
+		bool EntityHasTag(Entity entity, TagId tag) const;
+		Entity GetEntityByTag(TagId tag) const;
 		Entity GetEntityByTag(const std::string& tag) const;
 		void RemoveEntityTag(Entity entity);
 
         // Group management
-		void GroupEntity(Entity entity, const std::string& group);
-		bool EntityBelongsToGroup(Entity entity, const std::string& group) const;
+		void GroupEntity(Entity entity, GroupId group);
+		// Bulk version, cheapest when the entities are sorted by id (ex: just made by CreateEntities)
+		void GroupEntities(const std::vector<Entity>& entities, GroupId group);
+		bool EntityBelongsToGroup(Entity entity, GroupId group) const;
+		std::vector<Entity> GetEntitiesByGroup(GroupId group) const;
 		std::vector<Entity> GetEntitiesByGroup(const std::string& group) const;
 		void RemoveEntityGroup(Entity entity);
 
@@ -278,13 +880,61 @@ class Registry {
         // Add a component based on its type and arguments.
         template <typename TComponent, typename ...TArgs> void AddComponent(Entity entity, TArgs&& ...args);
 
+        // Add components[i] to entities[i], growing the storage once for all of them
+        // The components are moved out of the vector, which keeps its capacity for the caller to reuse
+        template <typename TComponent> void AddComponents(const std::vector<Entity>& entities, std::vector<TComponent>&& components);
+
         // Remove a component based on its type
         template <typename TComponent> void RemoveComponent(Entity entity);
 
         template <typename TComponent> bool HasComponent(Entity entity) const;
 
+        // The entity must be alive and have the component, check with HasComponent() when unsure.
+        // GetComponent<T> marks the component as changed, GetComponent<const T> is read only.
         template <typename TComponent> TComponent& GetComponent(Entity entity) const;
 
+        //##### Change Tracking #####################################################################
+
+        // Components are stamped with the current change tick when they are added, replaced or
+        // obtained mutably: GetComponent<T>() and View<T>() with a non const T.
+        unsigned int GetChangeTick() const { return m_changeTick.load(std::memory_order_relaxed); }
+
+        // Returns the current tick and starts a new one, everything written from now on is newer.
+        // A system keeps the returned tick and, on its next run, only processes the components
+        // changed after it (ex: View<const T>().EachChanged<T>(tick, ...)). Its own writes during
+        // the run are newer too, so it sees them again next time.
+        unsigned int AdvanceChangeTick() { return m_changeTick.fetch_add(1, std::memory_order_relaxed); }
+
+        // Tick of the last time the component of the entity was added or written
+        template <typename TComponent> unsigned int GetComponentChangeTick(Entity entity) const;
+
+        // Observers are called on the thread that adds/removes the component, usually the main thread
+        // inside Registry::Update(). OnComponentAdded is called right after the component is added
+        // (not when it is replaced), OnComponentRemoved right before it is removed, including when
+        // the entity is killed, so both can still read it.
+        template <typename TComponent> void OnComponentAdded(ComponentObserver observer);
+        template <typename TComponent> void OnComponentRemoved(ComponentObserver observer);
+
+#ifndef ECS_ARCHETYPE_STORAGE
+        // Returns the pool of a component type, or nullptr if no entity ever had that component
+        template <typename TComponent> Pool<TComponent>* GetComponentPool() const;
+#else
+        // Iterate the archetypes that contain all the components, see ComponentView
+        template <typename ...TComponents, typename TFunc> void EachInArchetypes(TFunc& func, int changedComponentId = -1, unsigned int sinceTick = 0);
+        template <typename ...TComponents> int GetNumArchetypeChunks() const;
+        template <typename ...TComponents, typename TFunc> void EachInArchetypeChunk(int chunk, TFunc& func);
+#endif
+
+        // Query all the entities that have every component listed in TComponents
+        // ex: registry->View<TransformComponent, RigidBodyComponent>().Each([](Entity e, auto& t, auto& rb) {...});
+        template <typename ...TComponents> ComponentView<TComponents...> View();
+
+        // Owning group of the components, to be created once at setup before the systems run
+        // (it sorts the pools of the entities that already exist). Iterate it like a view with
+        // GetOwningGroup, TComponents may be listed in any order and as const.
+        template <typename ...TComponents> void CreateOwningGroup();
+        template <typename ...TComponents> OwningGroup<TComponents...> GetOwningGroup();
+
         //##### System Managment ####################################################################
 
         // Add and remove entities from their systems.
@@ -310,12 +960,14 @@ template <typename TSystem, typename ...TArgs>
 void Registry::AddSystem(TArgs&& ...args) {
     std::shared_ptr<TSystem> newSystem = std::make_shared<TSystem>(std::forward<TArgs>(args)...);
     m_systems.insert(std::make_pair( std::type_index(typeid(TSystem)), newSystem ));
+    m_systemsPerSignature.clear();
 }
 
 template <typename TSystem> 
 void Registry::RemoveSystem() {
     auto system = m_systems.find(std::type_index(typeid(TSystem)));
     m_systems.erase(system);
+    m_systemsPerSignature.clear();
 }
 
 template <typename TSystem> 
@@ -329,12 +981,94 @@ TSystem& Registry::GetSystem() const {
     return *(std::static_pointer_cast<TSystem>(system->second));
 }
 
+#ifdef ECS_ARCHETYPE_STORAGE
+
 template <typename TComponent, typename ...TArgs> 
 void Registry::AddComponent(Entity entity, TArgs&& ...args) {
-    
     const auto componentId = Component<TComponent>::GetId();
     const auto entityId = entity.GetId();
 
+    // Moves the entity to the archetype of its new signature and constructs the component there
+    m_archetypeStorage.Add<TComponent>(componentId, entityId, m_entityComponentSignatures[entityId], GetChangeTick(), std::forward<TArgs>(args)...);
+    const bool isNew = !m_entityComponentSignatures[entityId].test(componentId);
+    m_entityComponentSignatures[entityId].set(componentId);
+    if (isNew) {
+        NotifyComponentAdded(componentId, entity);
+    }
+}
+
+template <typename TComponent>
+void Registry::AddComponents(const std::vector<Entity>& entities, std::vector<TComponent>&& components) {
+    // Each entity still moves to the archetype of its new signature, one by one
+    for (size_t i = 0; i < entities.size(); i++) {
+        AddComponent<TComponent>(entities[i], std::move(components[i]));
+    }
+}
+
+template <typename TComponent> 
+void Registry::RemoveComponent(Entity entity) {
+    const auto componentId = Component<TComponent>::GetId();
+    const auto entityId = entity.GetId();
+
+    NotifyComponentRemoved(componentId, entity);
+
+    m_archetypeStorage.Remove(componentId, entityId, m_entityComponentSignatures[entityId]);
+    m_entityComponentSignatures[entityId].set(componentId, false);
+}
+
+template <typename TComponent> 
+TComponent& Registry::GetComponent(Entity entity) const {
+    if constexpr (std::is_const<TComponent>::value) {
+        return m_archetypeStorage.Get<TComponent>(Component<TComponent>::GetId(), entity.GetId());
+    } else {
+        return m_archetypeStorage.GetMutable<TComponent>(Component<TComponent>::GetId(), entity.GetId(), GetChangeTick());
+    }
+}
+
+template <typename TComponent> 
+unsigned int Registry::GetComponentChangeTick(Entity entity) const {
+    return m_archetypeStorage.GetChangeTick(Component<TComponent>::GetId(), entity.GetId());
+}
+
+template <typename ...TComponents, typename TFunc> 
+void Registry::EachInArchetypes(TFunc& func, int changedComponentId, unsigned int sinceTick) {
+    const std::array<int, sizeof...(TComponents)> componentIds{ Component<TComponents>::GetId()... };
+    m_archetypeStorage.Each<TComponents...>(componentIds, GetChangeTick(), m_entityIsActive, func, changedComponentId, sinceTick);
+}
+
+template <typename ...TComponents> 
+int Registry::GetNumArchetypeChunks() const {
+    const std::array<int, sizeof...(TComponents)> componentIds{ Component<TComponents>::GetId()... };
+    return m_archetypeStorage.GetNumChunks(componentIds);
+}
+
+template <typename ...TComponents, typename TFunc> 
+void Registry::EachInArchetypeChunk(int chunk, TFunc& func) {
+    const std::array<int, sizeof...(TComponents)> componentIds{ Component<TComponents>::GetId()... };
+    m_archetypeStorage.EachInChunk<TComponents...>(componentIds, chunk, GetChangeTick(), m_entityIsActive, func);
+}
+
+template <typename ...TComponents> 
+ComponentView<TComponents...> Registry::View() {
+    return ComponentView<TComponents...>(this);
+}
+
+// The archetypes already keep the entities with the same components together
+template <typename ...TComponents> 
+void Registry::CreateOwningGroup() {
+}
+
+template <typename ...TComponents> 
+OwningGroup<TComponents...> Registry::GetOwningGroup() {
+    return View<TComponents...>();
+}
+
+#else
+
+template <typename TComponent>
+Pool<TComponent>* Registry::GetOrCreateComponentPool() {
+    const auto componentId = Component<TComponent>::GetId();
+
     // if the component id is greater then the current size of the componentPools, then resize the vector
     // in other words, if we have a new component type we need to acomodate for that.
     if (componentId >= static_cast<int>(m_componentTypePools.size())) {
@@ -343,34 +1077,96 @@ void Registry::AddComponent(Entity entity, TArgs&& ...args) {
 
     // If we do not have a pool for that component type we create one.
     if (!m_componentTypePools[componentId]) {
-        std::shared_ptr<Pool<TComponent>> newComponentPool = std::make_shared<Pool<TComponent>>();
-        m_componentTypePools[componentId] = newComponentPool;
+        m_componentTypePools[componentId] = std::make_shared<Pool<TComponent>>();
     }
+    return static_cast<Pool<TComponent>*>(m_componentTypePools[componentId].get());
+}
 
-    // Getting the pool of component values for that component type
-    std::shared_ptr<Pool<TComponent>> componentPool = std::static_pointer_cast<Pool<TComponent>>(m_componentTypePools[componentId]);
+template <typename TComponent, typename ...TArgs> 
+void Registry::AddComponent(Entity entity, TArgs&& ...args) {
+    
+    const auto componentId = Component<TComponent>::GetId();
+    const auto entityId = entity.GetId();
 
-    // Create a new Component object of the type T(generic), and forward the parameters to the constructor.
-    // Ex: TransformComponent newComponent(Posx, PosY, etc..)
-    TComponent newComponent(std::forward<TArgs>(args)...);
+    // Getting the pool of component values for that component type
+    auto componentPool = GetOrCreateComponentPool<TComponent>();
 
-    // Add the new componenet to the component type pool list using the entity id as index.
-    componentPool->Set(entityId, newComponent);
+    // Construct the new component right in the pool, using the entity id as index, and forward
+    // the parameters to its constructor. Ex: TransformComponent(Posx, PosY, etc..)
+    componentPool->Emplace(entityId, GetChangeTick(), std::forward<TArgs>(args)...);
 
     // Finally, change the component signature of the entity and set the component id
+    const bool isNew = !m_entityComponentSignatures[entityId].test(componentId);
     m_entityComponentSignatures[entityId].set(componentId);
+    if (isNew) {
+        if (m_owningGroupPerComponent[componentId]) {
+            EnterOwningGroup(*m_owningGroupPerComponent[componentId], entityId);
+        }
+        NotifyComponentAdded(componentId, entity);
+    }
 
     //Logger::Log("Component id = " + std::to_string(componentId) + " was added to entity id " + std::to_string(entityId));
     //std::cout << "COMPONENT ID = " << componentId << "--> POOL SIZE: " << componentPool->GetSize() << std::endl;
 }
 
+template <typename TComponent>
+void Registry::AddComponents(const std::vector<Entity>& entities, std::vector<TComponent>&& components) {
+    if (entities.empty()) {
+        return;
+    }
+    const auto componentId = Component<TComponent>::GetId();
+
+    // Same pool lookup as AddComponent, done once for every entity
+    auto componentPool = GetOrCreateComponentPool<TComponent>();
+    OwningGroupData* owningGroup = m_owningGroupPerComponent[componentId];
+
+    // Grow the dense arrays once, the new components are appended contiguously
+    componentPool->ReserveAdditional(static_cast<int>(entities.size()));
+    const auto changeTick = GetChangeTick();
+    for (size_t i = 0; i < entities.size(); i++) {
+        const auto entityId = entities[i].GetId();
+        componentPool->Emplace(entityId, changeTick, std::move(components[i]));
+        const bool isNew = !m_entityComponentSignatures[entityId].test(componentId);
+        m_entityComponentSignatures[entityId].set(componentId);
+        if (isNew) {
+            if (owningGroup) {
+                EnterOwningGroup(*owningGroup, entityId);
+            }
+            NotifyComponentAdded(componentId, entities[i]);
+        }
+    }
+}
+
+template <typename TComponent>
+void Registry::AddComponentCopies(const std::vector<Entity>& entities, const TComponent& component) {
+    const auto componentId = Component<TComponent>::GetId();
+    auto componentPool = GetOrCreateComponentPool<TComponent>();
+
+    componentPool->ReserveAdditional(static_cast<int>(entities.size()));
+    const auto changeTick = GetChangeTick();
+    for (const auto& entity: entities) {
+        componentPool->Emplace(entity.GetId(), changeTick, component);
+        m_entityComponentSignatures[entity.GetId()].set(componentId);
+    }
+}
+
+template <typename T>
+void PrefabComponent<T>::AddCopies(Registry& registry, const std::vector<Entity>& entities) const {
+    registry.AddComponentCopies<T>(entities, m_component);
+}
+
 template <typename TComponent> 
 void Registry::RemoveComponent(Entity entity) {
     const auto componentId = Component<TComponent>::GetId();
     const auto entityId = entity.GetId();
 
+    NotifyComponentRemoved(componentId, entity);
+    if (m_owningGroupPerComponent[componentId]) {
+        LeaveOwningGroup(*m_owningGroupPerComponent[componentId], entityId);
+    }
+
     // Remove the component from the component list for that entity (handling component pools)
-    std::shared_ptr<Pool<TComponent>> componentPool = std::static_pointer_cast<Pool<TComponent>>(m_componentTypePools[componentId]);
+    auto componentPool = static_cast<Pool<TComponent>*>(m_componentTypePools[componentId].get());
     componentPool->Remove(entityId);
 
     // Set this component signature for that entity
@@ -380,21 +1176,459 @@ void Registry::RemoveComponent(Entity entity) {
 };
 
 template <typename TComponent> 
-bool Registry::HasComponent(Entity entity) const {
+TComponent& Registry::GetComponent(Entity entity) const {
     const auto componentId = Component<TComponent>::GetId();
     const auto entityId = entity.GetId();
+    // Plain static_cast on the raw pointer, no shared_ptr copy (and refcount traffic) per lookup
+    auto componentPool = static_cast<Pool<std::remove_const_t<TComponent>>*>(m_componentTypePools[componentId].get());
+    if constexpr (std::is_const<TComponent>::value) {
+        return componentPool->Get(entityId);
+    } else {
+        return componentPool->GetMutable(entityId, GetChangeTick());
+    }
+}
 
-    return m_entityComponentSignatures[entityId].test(componentId);
+template <typename TComponent> 
+unsigned int Registry::GetComponentChangeTick(Entity entity) const {
+    const auto componentId = Component<TComponent>::GetId();
+    auto componentPool = static_cast<Pool<std::remove_const_t<TComponent>>*>(m_componentTypePools[componentId].get());
+    return componentPool->GetChangeTick(entity.GetId());
 }
 
+
 template <typename TComponent> 
-TComponent& Registry::GetComponent(Entity entity) const {
+Pool<TComponent>* Registry::GetComponentPool() const {
+    const auto componentId = Component<TComponent>::GetId();
+    if (componentId >= static_cast<int>(m_componentTypePools.size())) {
+        return nullptr;
+    }
+    return static_cast<Pool<TComponent>*>(m_componentTypePools[componentId].get());
+}
+
+template <typename ...TComponents> 
+ComponentView<TComponents...> Registry::View() {
+    return ComponentView<TComponents...>(this, GetComponentPool<std::remove_const_t<TComponents>>()...);
+}
+
+template <typename ...TComponents> 
+void Registry::CreateOwningGroup() {
+    Signature owned;
+    (owned.set(Component<TComponents>::GetId()), ...);
+    for (int componentId: { Component<TComponents>::GetId()... }) {
+        if (m_owningGroupPerComponent[componentId]) {
+            Logger::Error("Owning group not created, the pool of component id = " + std::to_string(componentId) + " is already owned by another group");
+            return;
+        }
+    }
+
+    auto group = std::make_unique<OwningGroupData>();
+    group->owned = owned;
+    group->pools = { GetOrCreateComponentPool<std::remove_const_t<TComponents>>()... };
+    for (int componentId: { Component<TComponents>::GetId()... }) {
+        m_owningGroupPerComponent[componentId] = group.get();
+    }
+
+    // Sort the entities that already have all the components into the group
+    for (int entityId = 0; entityId < static_cast<int>(m_entityComponentSignatures.size()); entityId++) {
+        EnterOwningGroup(*group, entityId);
+    }
+    m_owningGroups.push_back(std::move(group));
+}
+
+template <typename ...TComponents> 
+OwningGroup<TComponents...> Registry::GetOwningGroup() {
+    Signature owned;
+    (owned.set(Component<TComponents>::GetId()), ...);
+    for (auto& group: m_owningGroups) {
+        if (group->owned == owned) {
+            return OwningGroup<TComponents...>(this, group.get(), GetComponentPool<std::remove_const_t<TComponents>>()...);
+        }
+    }
+    Logger::Error("No owning group was created for these components, see Registry::CreateOwningGroup");
+    return OwningGroup<TComponents...>(this, nullptr, GetComponentPool<std::remove_const_t<TComponents>>()...);
+}
+
+#endif
+
+template <typename TComponent>
+void Registry::OnComponentAdded(ComponentObserver observer) {
+    const auto componentId = Component<TComponent>::GetId();
+    if (componentId >= static_cast<int>(m_onComponentAdded.size())) {
+        m_onComponentAdded.resize(componentId + 1);
+    }
+    m_onComponentAdded[componentId].push_back(std::move(observer));
+}
+
+template <typename TComponent>
+void Registry::OnComponentRemoved(ComponentObserver observer) {
+    const auto componentId = Component<TComponent>::GetId();
+    if (componentId >= static_cast<int>(m_onComponentRemoved.size())) {
+        m_onComponentRemoved.resize(componentId + 1);
+    }
+    m_onComponentRemoved[componentId].push_back(std::move(observer));
+}
+
+template <typename TComponent, typename ...TArgs>
+void CommandBuffer::AddComponent(Entity entity, TArgs&& ...args) {
+    const auto componentId = Component<TComponent>::GetId();
+    if (componentId >= static_cast<int>(m_additions.size())) {
+        m_additions.resize(componentId + 1);
+    }
+    if (!m_additions[componentId]) {
+        m_additions[componentId] = std::make_unique<ComponentCommands<TComponent>>();
+    }
+
+    auto* additions = static_cast<ComponentCommands<TComponent>*>(m_additions[componentId].get());
+    additions->m_entities.push_back(entity);
+    additions->m_components.emplace_back(std::forward<TArgs>(args)...);
+    m_isEmpty = false;
+}
+
+template <typename TComponent>
+void CommandBuffer::RemoveComponent(Entity entity) {
+    m_removals.push_back({ Component<TComponent>::GetId(), entity });
+    m_isEmpty = false;
+}
+
+template <typename T>
+void ComponentCommands<T>::ResolvePlaceholders(const std::vector<Entity>& createdEntities) {
+    for (auto& entity: m_entities) {
+        entity = CommandBuffer::ResolveEntity(entity, createdEntities);
+    }
+}
+
+template <typename T>
+void ComponentCommands<T>::ApplyAll(Registry& registry, const std::vector<IComponentCommands*>& lists) {
+    // (entity id, component) of every buffer, sorted by entity id so the pool is written in order.
+    // The sort is stable, if an entity got the component twice the last one recorded wins.
+    auto& additions = m_sortedAdditions;
+    additions.clear();
+    for (auto* list: lists) {
+        auto* typedList = static_cast<ComponentCommands<T>*>(list);
+        for (size_t i = 0; i < typedList->m_entities.size(); i++) {
+            if (registry.IsAlive(typedList->m_entities[i])) {
+                additions.emplace_back(typedList->m_entities[i], &typedList->m_components[i]);
+            }
+        }
+    }
+    auto byEntityId = [](const std::pair<Entity, T*>& a, const std::pair<Entity, T*>& b) {
+        return a.first.GetId() < b.first.GetId();
+    };
+    // Usually sorted already, a single buffer records the entities it creates in id order
+    if (!std::is_sorted(additions.begin(), additions.end(), byEntityId)) {
+        std::stable_sort(additions.begin(), additions.end(), byEntityId);
+    }
+
+    m_sortedEntities.clear();
+    m_sortedComponents.clear();
+    for (auto& addition: additions) {
+        m_sortedEntities.push_back(addition.first);
+        m_sortedComponents.push_back(std::move(*addition.second));
+    }
+    registry.AddComponents<T>(m_sortedEntities, std::move(m_sortedComponents));
+    m_sortedComponents.clear();
+}
+
+template <typename TComponent, typename ...TArgs>
+void Prefab::AddComponent(TArgs&& ...args) {
+    const auto componentId = Component<TComponent>::GetId();
+    m_components[componentId] = std::make_unique<PrefabComponent<TComponent>>(std::forward<TArgs>(args)...);
+    m_signature.set(componentId);
+}
+
+template <typename TComponent>
+void Prefab::RemoveComponent() {
+    const auto componentId = Component<TComponent>::GetId();
+    m_components[componentId].reset();
+    m_signature.set(componentId, false);
+}
+
+template <typename TComponent>
+bool Prefab::HasComponent() const {
+    return m_signature.test(Component<TComponent>::GetId());
+}
+
+template <typename TComponent>
+TComponent& Prefab::GetComponent() const {
+    auto* component = static_cast<PrefabComponent<std::remove_const_t<TComponent>>*>(m_components[Component<TComponent>::GetId()].get());
+    return component->m_component;
+}
+
+template <typename TComponent> 
+bool Registry::HasComponent(Entity entity) const {
     const auto componentId = Component<TComponent>::GetId();
     const auto entityId = entity.GetId();
-    auto componentPool =  std::static_pointer_cast<Pool<TComponent>>(m_componentTypePools[componentId]);
-    return componentPool->Get(entityId);
+
+    // A dead handle has no components, whatever entity reuses its id now
+    return IsAlive(entity) && m_entityComponentSignatures[entityId].test(componentId);
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////
+// ComponentView
+///////////////////////////////////////////////////////////////////////////////////////////////
+//// Iterates all the entities that have every component in TComponents.
+///  It walks the dense array of the smallest pool and tests the membership of the other
+///  pools in O(1), handing references to all the components to a single callback.
+///  Components viewed as const T are read only, the others are handed out for writing and
+///  get their change tick stamped (ex: View<TransformComponent, const RigidBodyComponent>).
+///  Kill() and CreateEntity() are buffered so they are safe inside Each(), but adding or
+///  removing one of the viewed component types while iterating is not.
+///  Sleeping entities (Entity::SetActive) are skipped.
+///  With ECS_ARCHETYPE_STORAGE it walks the chunks of every matching archetype instead.
+///  The view is also split in blocks (GetNumBlocks/EachInBlock) that can be iterated by
+///  different threads at the same time, see ParallelForEach.
+///////////////////////////////////////////////////////////////////////////////////////////////
+#ifdef ECS_ARCHETYPE_STORAGE
+
+template <typename ...TComponents>
+class ComponentView {
+    private:
+        Registry* m_registry;
+
+    public:
+        ComponentView(Registry* registry): m_registry(registry) {}
+
+        // Calls func(Entity, TComponents&...) for every entity that has all the components
+        template <typename TFunc>
+        void Each(TFunc func) const {
+            Registry* registry = m_registry;
+            auto callback = [registry, &func](int entityId, TComponents&... components) {
+                func(registry->GetEntity(entityId), components...);
+            };
+            m_registry->EachInArchetypes<TComponents...>(callback);
+        }
+
+        // Same as Each(), limited to the entities whose TChanged component was added or written after
+        // sinceTick (see Registry::AdvanceChangeTick)
+        template <typename TChanged, typename TFunc>
+        void EachChanged(unsigned int sinceTick, TFunc func) const {
+            static_assert((std::is_same<std::remove_const_t<TComponents>, std::remove_const_t<TChanged>>::value || ...), "EachChanged: the component must be part of the view");
+            Registry* registry = m_registry;
+            auto callback = [registry, &func](int entityId, TComponents&... components) {
+                func(registry->GetEntity(entityId), components...);
+            };
+            m_registry->EachInArchetypes<TComponents...>(callback, Component<TChanged>::GetId(), sinceTick);
+        }
+
+        // One block per archetype chunk
+        int GetNumBlocks() const {
+            return m_registry->GetNumArchetypeChunks<TComponents...>();
+        }
+
+        // Same as Each(), limited to the entities of one block
+        template <typename TFunc>
+        void EachInBlock(int block, TFunc func) const {
+            Registry* registry = m_registry;
+            auto callback = [registry, &func](int entityId, TComponents&... components) {
+                func(registry->GetEntity(entityId), components...);
+            };
+            m_registry->EachInArchetypeChunk<TComponents...>(block, callback);
+        }
+};
+
+#else
+
+template <typename ...TComponents>
+class ComponentView {
+    private:
+        Registry* m_registry;
+        std::tuple<Pool<std::remove_const_t<TComponents>>*...> m_pools;
+
+        // Non const components are handed out for writing and get their change tick stamped
+        template <typename TComponent, typename TPool>
+        static TComponent& GetFromPool(TPool* pool, int entityId, unsigned int changeTick) {
+            if constexpr (std::is_const<TComponent>::value) {
+                return pool->Get(entityId);
+            } else {
+                return pool->GetMutable(entityId, changeTick);
+            }
+        }
+
+        // Index of TComponent (const or not) in TComponents
+        template <typename TComponent>
+        static constexpr size_t IndexOf() {
+            constexpr bool matches[] = { std::is_same<std::remove_const_t<TComponents>, std::remove_const_t<TComponent>>::value... };
+            for (size_t i = 0; i < sizeof...(TComponents); i++) {
+                if (matches[i]) {
+                    return i;
+                }
+            }
+            return sizeof...(TComponents);
+        }
+
+        // Size of each pool, the view is empty if any of the pools does not exist yet
+        std::array<int, sizeof...(TComponents)> GetPoolSizes() const {
+            return std::apply([](auto*... pools) {
+                return std::array<int, sizeof...(TComponents)>{ (pools ? pools->GetSize() : 0)... };
+            }, m_pools);
+        }
+
+        // Index of the smallest pool, it drives the iteration
+        size_t GetDrivingPool(const std::array<int, sizeof...(TComponents)>& sizes) const {
+            size_t smallest = 0;
+            for (size_t i = 1; i < sizes.size(); i++) {
+                if (sizes[i] < sizes[smallest]) {
+                    smallest = i;
+                }
+            }
+            return smallest;
+        }
+
+        // Walk the dense entity array of the pool at index IDriving in [begin, end), testing the others.
+        // Dense indexes rejected by skip(index) are not visited.
+        template <size_t IDriving, typename TFunc, typename TSkip, size_t ...Is>
+        void EachDrivenBy(int begin, int end, TFunc& func, TSkip& skip, std::index_sequence<Is...>) const {
+            auto* drivingPool = std::get<IDriving>(m_pools);
+            const unsigned int changeTick = m_registry->GetChangeTick();
+
+            for (int i = begin; i < end; i++) {
+                if (skip(i)) {
+                    continue;
+                }
+                const int entityId = drivingPool->GetEntityId(i);
+                if (!m_registry->IsEntityActive(entityId)) {
+                    continue;
+                }
+                const bool hasAll = std::apply([entityId](auto*... pools) {
+                    return (pools->Has(entityId) && ...);
+                }, m_pools);
+                if (!hasAll) {
+                    continue;
+                }
+
+                func(m_registry->GetEntity(entityId), GetFromPool<TComponents>(std::get<Is>(m_pools), entityId, changeTick)...);
+            }
+        }
+
+        template <typename TFunc, size_t ...Is>
+        void EachDrivenBy(size_t drivingIndex, int begin, int end, TFunc& func, std::index_sequence<Is...> indexes) const {
+            auto noSkip = [](int) { return false; };
+            ((drivingIndex == Is ? EachDrivenBy<Is>(begin, end, func, noSkip, indexes) : void()), ...);
+        }
+
+    public:
+        // Number of entities of the driving pool in each block
+        static constexpr int BLOCK_SIZE = 1024;
+
+        ComponentView(Registry* registry, Pool<std::remove_const_t<TComponents>>*... pools): m_registry(registry), m_pools(pools...) {}
+
+        // Calls func(Entity, TComponents&...) for every entity that has all the components
+        template <typename TFunc>
+        void Each(TFunc func) const {
+            const auto sizes = GetPoolSizes();
+            const size_t smallest = GetDrivingPool(sizes);
+            if (sizes[smallest] == 0) {
+                return;
+            }
+
+            EachDrivenBy(smallest, 0, sizes[smallest], func, std::index_sequence_for<TComponents...>{});
+        }
+
+        // Same as Each(), limited to the entities whose TChanged component was added or written after
+        // sinceTick (see Registry::AdvanceChangeTick). TChanged must be one of the viewed components,
+        // its pool drives the iteration so the unchanged components cost one tick compare each.
+        template <typename TChanged, typename TFunc>
+        void EachChanged(unsigned int sinceTick, TFunc func) const {
+            constexpr size_t changedIndex = IndexOf<TChanged>();
+            static_assert(changedIndex < sizeof...(TComponents), "EachChanged: the component must be part of the view");
+
+            const auto sizes = GetPoolSizes();
+            if (sizes[GetDrivingPool(sizes)] == 0) {
+                return;
+            }
+
+            auto* changedPool = std::get<changedIndex>(m_pools);
+            auto isUnchanged = [changedPool, sinceTick](int index) {
+                return changedPool->GetChangeTickAt(index) <= sinceTick;
+            };
+            EachDrivenBy<changedIndex>(0, sizes[changedIndex], func, isUnchanged, std::index_sequence_for<TComponents...>{});
+        }
+
+        int GetNumBlocks() const {
+            const auto sizes = GetPoolSizes();
+            return (sizes[GetDrivingPool(sizes)] + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        }
+
+        // Same as Each(), limited to the entities of one block
+        template <typename TFunc>
+        void EachInBlock(int block, TFunc func) const {
+            const auto sizes = GetPoolSizes();
+            const size_t smallest = GetDrivingPool(sizes);
+            const int begin = block * BLOCK_SIZE;
+            const int end = std::min(begin + BLOCK_SIZE, sizes[smallest]);
+
+            EachDrivenBy(smallest, begin, end, func, std::index_sequence_for<TComponents...>{});
+        }
+};
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// OwningGroup
+///////////////////////////////////////////////////////////////////////////////////////////////
+//// Iterates the entities of an owning group (see Registry::CreateOwningGroup): entry i of every
+///  owned pool belongs to the same entity for i < GetSize(), so Each() walks the dense arrays
+///  side by side without testing anything. Same interface as ComponentView, including the
+///  blocks for ParallelForEach and the const components that are not stamped as changed.
+///////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef ECS_ARCHETYPE_STORAGE
+
+template <typename ...TComponents>
+class OwningGroup {
+    private:
+        Registry* m_registry;
+        const OwningGroupData* m_group;
+        std::tuple<Pool<std::remove_const_t<TComponents>>*...> m_pools;
+
+        template <typename TComponent, typename TPool>
+        static TComponent& GetFromPool(TPool* pool, int index, unsigned int changeTick) {
+            if constexpr (std::is_const<TComponent>::value) {
+                return (*pool)[index];
+            } else {
+                return pool->GetMutableAt(index, changeTick);
+            }
+        }
+
+        template <typename TFunc, size_t ...Is>
+        void EachInRange(int begin, int end, TFunc& func, std::index_sequence<Is...>) const {
+            auto* firstPool = std::get<0>(m_pools);
+            const unsigned int changeTick = m_registry->GetChangeTick();
+
+            for (int i = begin; i < end; i++) {
+                func(m_registry->GetEntity(firstPool->GetEntityId(i)), GetFromPool<TComponents>(std::get<Is>(m_pools), i, changeTick)...);
+            }
+        }
+
+    public:
+        // Number of entities in each block
+        static constexpr int BLOCK_SIZE = 1024;
+
+        OwningGroup(Registry* registry, const OwningGroupData* group, Pool<std::remove_const_t<TComponents>>*... pools): m_registry(registry), m_group(group), m_pools(pools...) {}
+
+        int GetSize() const {
+            return m_group ? m_group->size : 0;
+        }
+
+        // Calls func(Entity, TComponents&...) for every entity of the group
+        template <typename TFunc>
+        void Each(TFunc func) const {
+            EachInRange(0, GetSize(), func, std::index_sequence_for<TComponents...>{});
+        }
+
+        int GetNumBlocks() const {
+            return (GetSize() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        }
+
+        // Same as Each(), limited to the entities of one block
+        template <typename TFunc>
+        void EachInBlock(int block, TFunc func) const {
+            const int begin = block * BLOCK_SIZE;
+            EachInRange(begin, std::min(begin + BLOCK_SIZE, GetSize()), func, std::index_sequence_for<TComponents...>{});
+        }
+};
+
+#endif
+
 template <typename TComponent, typename ...TArgs> 
 void Entity::AddComponent(TArgs&& ...args) {
     m_registry->AddComponent<TComponent>(*this, std::forward<TArgs>(args)...);
@@ -420,6 +1654,17 @@ template <typename TComponent>
 void System::RequireComponent(){
     const auto componentId = Component<TComponent>::GetId();
     System::m_componentSignature.set(componentId);
+    System::m_readSignature.set(componentId);
+};
+
+template <typename TComponent>
+void System::ReadsComponent(){
+    System::m_readSignature.set(Component<TComponent>::GetId());
+};
+
+template <typename TComponent>
+void System::WritesComponent(){
+    System::m_writeSignature.set(Component<TComponent>::GetId());
 };
 
 #endif
\ No newline at end of file
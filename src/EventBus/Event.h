@@ -1,9 +1,33 @@
 #ifndef EVENT_H
 #define EVENT_H
 
+#include <cstdint>
+
 class Event {
     public:
         Event() = default;
 };
 
+// How the queued events of a type are ordered before they are dispatched (see EventBus::QueueEvent).
+// Without a specialization they keep the order of the threads that queued them, which changes with
+// the number of threads. Events queued from several threads should specialize it with:
+//   static constexpr bool isOrdered = true;
+//   static uint64_t GetKey(const TEvent& event);
+// Two events with the same key must be the same, their order is not kept.
+template <typename TEvent>
+struct EventOrder {
+    static constexpr bool isOrdered = false;
+};
+
+// The entities an event is about, for the subscriptions filtered by entity (see EntityFilter).
+// Events about entities specialize it with:
+//   static constexpr int numEntities = 2;
+//   static constexpr bool isSymmetric = true;  // two entities playing the same role (ex: a collision)
+//   static Entity& GetEntity(TEvent& event, int index);
+template <typename TEvent>
+struct EventEntities {
+    static constexpr int numEntities = 0;
+    static constexpr bool isSymmetric = false;
+};
+
 #endif
\ No newline at end of file
@@ -3,81 +3,921 @@
 
 #include "../ECS/ECS.h"
 #include "../Logger/Logger.h"
-#include <map>
-#include <typeindex>
-#include <list>
 #include "./Event.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
-class IEventCallBack {
+template <typename ...TEvents>
+struct EventList {
+    static constexpr unsigned int size = sizeof...(TEvents);
+};
+
+#include "../Events/EventManifest.h"
+
+const unsigned int MAX_EVENT_TYPES = EventManifest::size;
+
+// Position of TEvent in an EventList, or the size of the list if it is not there
+template <typename TEvent, typename TList>
+struct EventIndex;
+
+template <typename TEvent>
+struct EventIndex<TEvent, EventList<>> {
+    static constexpr int value = 0;
+};
+
+template <typename TEvent, typename ...TOthers>
+struct EventIndex<TEvent, EventList<TEvent, TOthers...>> {
+    static constexpr int value = 0;
+};
+
+template <typename TEvent, typename TFirst, typename ...TOthers>
+struct EventIndex<TEvent, EventList<TFirst, TOthers...>> {
+    static constexpr int value = 1 + EventIndex<TEvent, EventList<TOthers...>>::value;
+};
+
+// Used to get the unique id of an event type, its index in the EventManifest
+template <typename TEvent>
+class EventType {
     private:
-        virtual void Call(Event& e) = 0;
+        static constexpr int m_id = EventIndex<std::remove_const_t<TEvent>, EventManifest>::value;
+        static_assert(m_id < static_cast<int>(MAX_EVENT_TYPES), "Event type missing from EventManifest.h");
+
+    public:
+        static constexpr int GetId() {
+            return m_id;
+        }
+};
+
+// 0 is never given to a subscription
+typedef uint32_t SubscriptionId;
+
+// Events of one type handed at once to a batch handler (see EventBus::SubscribeToEventBatches)
+template <typename TEvent>
+class EventSpan {
+    private:
+        TEvent* m_events;
+        size_t m_numEvents;
+
+    public:
+        EventSpan(TEvent* events, size_t numEvents): m_events(events), m_numEvents(numEvents) {}
+
+        TEvent* begin() const { return m_events; }
+        TEvent* end() const { return m_events + m_numEvents; }
+        TEvent& operator [](size_t index) const { return m_events[index]; }
+        size_t GetSize() const { return m_numEvents; }
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// EventHandlers
+////////////////////////////////////////////////////////////////////////////////////
+//// The handlers of every event type, one dense array per type indexed by the event id.
+//// Handlers can subscribe and unsubscribe while an event of their type is being emitted:
+//// the new ones are appended once the emission is over, the removed ones are only
+//// marked until then (id 0), so the array is never moved under the handler running.
+////////////////////////////////////////////////////////////////////////////////////
+struct EventHandler {
+    SubscriptionId id;
+    // Called with an array of events of the type of the list, one event when it is emitted right away
+    std::function<void(void* events, size_t numEvents)> callback;
+};
+
+struct EventHandlerList {
+    std::vector<EventHandler> handlers;
+
+    // Subscribed during an emission, appended when it ends
+    std::vector<EventHandler> addedHandlers;
+    int numEmitting = 0;
+    bool hasRemovedHandlers = false;
+
+    void Add(EventHandler&& handler) {
+        if (numEmitting > 0) {
+            addedHandlers.push_back(std::move(handler));
+        }
+        else {
+            handlers.push_back(std::move(handler));
+        }
+    }
+
+    void Remove(SubscriptionId id) {
+        for (auto it = addedHandlers.begin(); it != addedHandlers.end(); it++) {
+            if (it->id == id) {
+                addedHandlers.erase(it);
+                return;
+            }
+        }
+        for (auto it = handlers.begin(); it != handlers.end(); it++) {
+            if (it->id == id) {
+                if (numEmitting > 0) {
+                    it->id = 0;
+                    hasRemovedHandlers = true;
+                }
+                else {
+                    handlers.erase(it);
+                }
+                return;
+            }
+        }
+    }
 
+    void Emit(void* events, size_t numEvents) {
+        numEmitting++;
+        for (size_t i = 0; i < handlers.size(); i++) {
+            if (handlers[i].id != 0) {
+                handlers[i].callback(events, numEvents);
+            }
+        }
+        EndEmit();
+    }
+
+    // Applies the changes made by the handlers while the last emission was running
+    void EndEmit() {
+        if (--numEmitting > 0) {
+            return;
+        }
+        if (hasRemovedHandlers) {
+            handlers.erase(std::remove_if(handlers.begin(), handlers.end(), [](const EventHandler& handler) { return handler.id == 0; }), handlers.end());
+            hasRemovedHandlers = false;
+        }
+        if (!addedHandlers.empty()) {
+            for (auto& handler: addedHandlers) {
+                handlers.push_back(std::move(handler));
+            }
+            addedHandlers.clear();
+        }
+    }
+};
+
+// The filtered subscriptions of one event type (see EventRouter)
+class IEventRouter {
     public:
-        virtual ~IEventCallBack() = default;
+        virtual ~IEventRouter() = default;
+        virtual void Remove(SubscriptionId id) = 0;
+};
+
+struct EventHandlers {
+    std::array<EventHandlerList, MAX_EVENT_TYPES> lists;
+    // [Array index = event id], created by the first filtered subscription of the type
+    std::array<std::unique_ptr<IEventRouter>, MAX_EVENT_TYPES> routers;
+    SubscriptionId nextSubscriptionId = 1;
 
-        void Execute(Event& e) {
-            Call(e);
+    // The ids are unique across the lists and the routers, only one of them knows the subscription
+    void Remove(int eventId, SubscriptionId id) {
+        lists[eventId].Remove(id);
+        if (routers[eventId]) {
+            routers[eventId]->Remove(id);
         }
+    }
 };
 
-template <typename TOwner, typename TEvent>
-class EventCallBack: public IEventCallBack{
+////////////////////////////////////////////////////////////////////////////////////
+// Subscription
+////////////////////////////////////////////////////////////////////////////////////
+//// Returned by EventBus::SubscribeToEvent, the handler stays subscribed until the
+//// Subscription is destroyed or Unsubscribe() is called. A system keeps it as a member
+//// so it is subscribed exactly as long as it exists. It can outlive its EventBus.
+////////////////////////////////////////////////////////////////////////////////////
+class Subscription {
     private:
-        typedef void (TOwner::*CallbackFunction)(TEvent&);
+        std::weak_ptr<EventHandlers> m_handlers;
+        int m_eventId = -1;
+        SubscriptionId m_id = 0;
 
-        TOwner* m_ownerInstance;
-        CallbackFunction m_callbackFunction;
+    public:
+        Subscription() = default;
+        Subscription(std::weak_ptr<EventHandlers> handlers, int eventId, SubscriptionId id): m_handlers(std::move(handlers)), m_eventId(eventId), m_id(id) {}
 
-        // Here we have the callback function pointer that needs to be invoked
-        virtual void Call(Event& e) override {
-            std::invoke(m_callbackFunction, m_ownerInstance, static_cast<TEvent&>(e));
+        ~Subscription() {
+            Unsubscribe();
+        }
+
+        Subscription(const Subscription&) = delete;
+        Subscription& operator =(const Subscription&) = delete;
+
+        Subscription(Subscription&& other) noexcept: m_handlers(std::move(other.m_handlers)), m_eventId(other.m_eventId), m_id(other.m_id) {
+            other.m_eventId = -1;
+        }
+
+        // Replaces the handler subscribed by this one, if any
+        Subscription& operator =(Subscription&& other) noexcept {
+            if (this != &other) {
+                Unsubscribe();
+                m_handlers = std::move(other.m_handlers);
+                m_eventId = other.m_eventId;
+                m_id = other.m_id;
+                other.m_eventId = -1;
+            }
+            return *this;
+        }
+
+        void Unsubscribe() {
+            if (m_eventId == -1) {
+                return;
+            }
+            if (auto handlers = m_handlers.lock()) {
+                handlers->Remove(m_eventId, m_id);
+            }
+            m_handlers.reset();
+            m_eventId = -1;
+        }
+
+        bool IsSubscribed() const {
+            return m_eventId != -1 && !m_handlers.expired();
+        }
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// EventRing
+////////////////////////////////////////////////////////////////////////////////////
+//// A lock-free ring buffer of events with one producer and one consumer: the producer
+//// only writes the tail and the consumer only writes the head, each on its own cache
+//// line. It never grows by itself, Push() fails when it is full.
+////////////////////////////////////////////////////////////////////////////////////
+template <typename TEvent>
+class EventRing {
+    private:
+        struct alignas(TEvent) Slot {
+            unsigned char bytes[sizeof(TEvent)];
+        };
+
+        std::unique_ptr<Slot[]> m_slots;
+        // Always a power of 2, 0 until the first Reserve()
+        size_t m_capacity = 0;
+
+        alignas(64) std::atomic<size_t> m_head;
+        alignas(64) std::atomic<size_t> m_tail;
+        // Last head seen by the producer, it only reads m_head again when the ring looks full
+        size_t m_cachedHead = 0;
+
+        TEvent* GetEvent(size_t index) {
+            return reinterpret_cast<TEvent*>(m_slots[index & (m_capacity - 1)].bytes);
         }
 
     public:
-        EventCallBack(TOwner* ownerInstance, CallbackFunction callbackFunction) {
-            this->m_ownerInstance = ownerInstance;
-            this->m_callbackFunction = callbackFunction;
+        EventRing(): m_head(0), m_tail(0) {}
+
+        ~EventRing() {
+            PopAll([](TEvent&) {});
         }
 
-        virtual ~EventCallBack() override = default;
+        EventRing(const EventRing&) = delete;
+        EventRing& operator =(const EventRing&) = delete;
 
+        // Producer side
+        template <typename ...TArgs>
+        bool Push(TArgs&& ...args) {
+            const size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_cachedHead == m_capacity) {
+                m_cachedHead = m_head.load(std::memory_order_acquire);
+                if (tail - m_cachedHead == m_capacity) {
+                    return false;
+                }
+            }
+            new (GetEvent(tail)) TEvent(std::forward<TArgs>(args)...);
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side, calls func(TEvent&) for every event in the order they were pushed
+        template <typename TFunc>
+        void PopAll(TFunc func) {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            const size_t tail = m_tail.load(std::memory_order_acquire);
+            for (; head != tail; head++) {
+                TEvent* event = GetEvent(head);
+                func(*event);
+                event->~TEvent();
+            }
+            m_head.store(head, std::memory_order_release);
+        }
+
+        size_t GetCapacity() const {
+            return m_capacity;
+        }
+
+        // Grows the ring to hold at least capacity events. It must be empty, with no producer running.
+        void Reserve(size_t capacity) {
+            if (capacity <= m_capacity) {
+                return;
+            }
+            size_t newCapacity = 16;
+            while (newCapacity < capacity) {
+                newCapacity *= 2;
+            }
+            m_slots.reset(new Slot[newCapacity]);
+            m_capacity = newCapacity;
+            m_head.store(0, std::memory_order_relaxed);
+            m_tail.store(0, std::memory_order_relaxed);
+            m_cachedHead = 0;
+        }
 };
 
-typedef std::list<std::unique_ptr<IEventCallBack>> HandlerList;
+////////////////////////////////////////////////////////////////////////////////////
+// EventQueue
+////////////////////////////////////////////////////////////////////////////////////
+//// The events of one type queued during the frame (see EventBus::QueueEvent). Every
+//// thread pushes into the EventRing of its thread slot (see Registry::GetThreadSlot), so
+//// threads queueing at the same time never wait for each other. A full ring, or a thread
+//// without a slot, falls back to a vector behind a mutex, and the ring grows at the next
+//// dispatch so the following frames fit in it.
+//// The dispatch gathers the rings into one array. Events with an EventOrder are then sorted
+//// by their key, so the handlers see the same order whatever thread queued each event and
+//// however many threads there are. The other events keep the order of their thread slots.
+////////////////////////////////////////////////////////////////////////////////////
+class IEventQueue {
+    public:
+        virtual ~IEventQueue() = default;
+        virtual void Dispatch(EventHandlerList& handlerList) = 0;
+};
 
-class EventBus {
+template <typename TEvent>
+class EventQueue: public IEventQueue {
     private:
-        // Key is the EventType and the value is a pointer to a list of eventHandlers
-        std::map<std::type_index, std::unique_ptr<HandlerList>> m_subscribers;
+        std::array<EventRing<TEvent>, MAX_THREAD_SLOTS> m_rings;
+
+        std::mutex m_overflowMutex;
+        std::vector<TEvent> m_overflowEvents;
+        // Events of each slot that did not fit in its ring since the last dispatch
+        std::array<size_t, MAX_THREAD_SLOTS> m_numOverflowEvents{};
+
+        std::vector<TEvent> m_dispatchedEvents;
+
+        // Key and index of every dispatched event, the keys are computed once instead of at every
+        // comparison of the sort. Cleared, not freed, between frames.
+        std::vector<std::pair<uint64_t, uint32_t>> m_sortKeys;
+        std::vector<TEvent> m_sortedEvents;
+
+        void SortByKey() {
+            m_sortKeys.clear();
+            bool isSorted = true;
+            for (size_t i = 0; i < m_dispatchedEvents.size(); i++) {
+                m_sortKeys.emplace_back(EventOrder<TEvent>::GetKey(m_dispatchedEvents[i]), static_cast<uint32_t>(i));
+                isSorted = isSorted && (i == 0 || m_sortKeys[i - 1].first <= m_sortKeys[i].first);
+            }
+            // A single thread queueing in order is the common case
+            if (isSorted) {
+                return;
+            }
+            // The events come in a few sorted runs (one per thread), a merge sort takes them as they
+            // are while std::sort degrades on them
+            std::stable_sort(m_sortKeys.begin(), m_sortKeys.end());
+            m_sortedEvents.clear();
+            for (const auto& sortKey: m_sortKeys) {
+                m_sortedEvents.push_back(std::move(m_dispatchedEvents[sortKey.second]));
+            }
+            m_dispatchedEvents.swap(m_sortedEvents);
+        }
+
+    public:
+        template <typename ...TArgs>
+        void Push(TArgs&& ...args) {
+            const int threadSlot = Registry::GetThreadSlot();
+            if (threadSlot != -1 && m_rings[threadSlot].Push(std::forward<TArgs>(args)...)) {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(m_overflowMutex);
+            m_overflowEvents.emplace_back(std::forward<TArgs>(args)...);
+            if (threadSlot != -1) {
+                m_numOverflowEvents[threadSlot]++;
+            }
+        }
+
+        void Dispatch(EventHandlerList& handlerList) override {
+            for (auto& ring: m_rings) {
+                ring.PopAll([this](TEvent& event) {
+                    m_dispatchedEvents.push_back(std::move(event));
+                });
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_overflowMutex);
+                for (auto& event: m_overflowEvents) {
+                    m_dispatchedEvents.push_back(std::move(event));
+                }
+                m_overflowEvents.clear();
+
+                // The rings were just emptied, grow the ones that were too small this frame
+                for (int threadSlot = 0; threadSlot < static_cast<int>(MAX_THREAD_SLOTS); threadSlot++) {
+                    auto& numOverflowEvents = m_numOverflowEvents[threadSlot];
+                    if (numOverflowEvents > 0) {
+                        auto& ring = m_rings[threadSlot];
+                        ring.Reserve((ring.GetCapacity() + numOverflowEvents) * 2);
+                        numOverflowEvents = 0;
+                    }
+                }
+            }
+            if (m_dispatchedEvents.empty()) {
+                return;
+            }
+
+            if constexpr (EventOrder<TEvent>::isOrdered) {
+                SortByKey();
+            }
+
+            handlerList.Emit(m_dispatchedEvents.data(), m_dispatchedEvents.size());
+            m_dispatchedEvents.clear();
+        }
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+// EntityFilter
+////////////////////////////////////////////////////////////////////////////////////
+//// The entities a filtered subscription wants to hear about, by component, group, tag or
+//// handle. An empty filter matches every entity.
+//// ex: EntityFilter().Require<ProjectileComponent>().InGroup(projectilesGroup)
+////////////////////////////////////////////////////////////////////////////////////
+class EntityFilter {
+    private:
+        Signature m_signature;
+        GroupId m_group = -1;
+        TagId m_tag = -1;
+        bool m_isEntity = false;
+        Entity m_entity = Entity(-1);
 
     public:
-        EventBus() {
+        template <typename TComponent>
+        EntityFilter& Require() {
+            m_signature.set(Component<TComponent>::GetId());
+            return *this;
+        }
 
+        EntityFilter& InGroup(GroupId group) {
+            m_group = group;
+            return *this;
         }
 
-        ~EventBus() {
+        EntityFilter& WithTag(TagId tag) {
+            m_tag = tag;
+            return *this;
+        }
 
+        EntityFilter& Is(Entity entity) {
+            m_isEntity = true;
+            m_entity = entity;
+            return *this;
         }
 
-        //Clears subscriber list
-        void ClearSubscribers() {
-            m_subscribers.clear();
+        bool IsEmpty() const {
+            return m_signature.none() && m_group == -1 && m_tag == -1 && !m_isEntity;
+        }
+
+        const Signature& GetSignature() const { return m_signature; }
+        GroupId GetGroup() const { return m_group; }
+        TagId GetTag() const { return m_tag; }
+        bool IsEntity() const { return m_isEntity; }
+        Entity GetEntity() const { return m_entity; }
+
+        bool operator ==(const EntityFilter& other) const {
+            return m_signature == other.m_signature && m_group == other.m_group && m_tag == other.m_tag &&
+                m_isEntity == other.m_isEntity && (!m_isEntity || m_entity == other.m_entity);
+        }
+
+        bool Matches(Entity entity) const {
+            if (IsEmpty()) {
+                return true;
+            }
+            if (!entity.m_registry || !entity.IsAlive()) {
+                return false;
+            }
+            return MatchesAlive(entity, *entity.m_registry);
+        }
+
+        // Same as Matches() for a non empty filter and an entity known to be alive in the registry
+        bool MatchesAlive(Entity entity, const Registry& registry) const {
+            return (registry.GetEntitySignature(entity) & m_signature) == m_signature &&
+                (m_group == -1 || registry.GetEntityGroups(entity).test(m_group)) &&
+                (m_tag == -1 || registry.GetEntityTag(entity) == m_tag) &&
+                (!m_isEntity || entity == m_entity);
+        }
+};
+
+// One EntityFilter per entity of the event (see EventEntities), in the same order
+template <typename TEvent>
+using EventFilter = std::array<EntityFilter, EventEntities<TEvent>::numEntities>;
+
+////////////////////////////////////////////////////////////////////////////////////
+// EventRouter
+////////////////////////////////////////////////////////////////////////////////////
+//// The filtered subscriptions of one event type, subscribed to the bus as a single handler.
+//// When a subscription is made, every EntityFilter is indexed under its most selective key:
+//// the entity, else the tag, else the group, else the required components. Equal filters of
+//// different subscriptions are indexed once.
+//// At dispatch, the entities of each event are looked up in these tables. Only the filters
+//// found there are tested, so the cost of an event does not grow with the subscriptions that
+//// do not care about its entities. An event with an entity that no filter can match is
+//// dropped after the lookups.
+//// An event of a symmetric type (see EventEntities) is handed with its entities swapped when
+//// they match the filters in the other order. When they match in both orders (ex: two entities
+//// both in the enemies and the obstacles groups), it is handed twice, once in each order.
+//// Like the EventHandlerList, subscriptions made or removed by a handler while the router is
+//// dispatching only take effect once the dispatch is over.
+////////////////////////////////////////////////////////////////////////////////////
+template <typename TEvent>
+class EventRouter: public IEventRouter {
+    private:
+        typedef EventEntities<TEvent> Entities;
+        static constexpr int NUM_ENTITIES = Entities::numEntities;
+        static_assert(NUM_ENTITIES * NUM_ENTITIES <= 32, "EventRouter: too many entities in the event");
+        static_assert(MAX_GROUPS <= 64, "EventRouter: the groups of an entity are read as a 64 bits mask");
+
+        struct Route {
+            SubscriptionId id;
+            EventFilter<TEvent> filter;
+            std::function<void(EventSpan<TEvent>)> callback;
+        };
+
+        // A filter of a route, the side is the index of the entity of the event it filters
+        struct RouteSide {
+            int route;
+            int side;
+        };
+
+        // A different filter and the sides of the routes using it
+        struct IndexedFilter {
+            EntityFilter filter;
+            std::vector<RouteSide> sides;
+        };
+
+        // Scratch of one dispatched batch, reused by the next ones. A dispatch nested in a handler takes its own.
+        struct Batch {
+            // Indexed filters to test for every entity of the current event, the ones of entity i
+            // start at firstCandidates[i]
+            std::vector<const std::vector<int>*> candidates;
+            std::array<size_t, NUM_ENTITIES + 1> firstCandidates;
+            // [Vector index = route] Bit side * NUM_ENTITIES + i is set when entity i of the event matches the side
+            std::vector<uint32_t> matches;
+            // Routes with a match for the current event
+            std::vector<int> matchingRoutes;
+            // [Vector index = route] Matching events of the batch, copied side by side
+            std::vector<std::vector<TEvent>> routedEvents;
+        };
+
+        std::vector<Route> m_routes;
+        // Subscribed during a dispatch, appended when it ends
+        std::vector<Route> m_addedRoutes;
+        int m_numDispatching = 0;
+        bool m_hasRemovedRoutes = false;
+
+        // Index of the filters, rebuilt when the routes change. The tables hold indices in m_filters.
+        std::vector<IndexedFilter> m_filters;
+        std::unordered_map<int, std::vector<int>> m_filtersPerEntityId;
+        // [Vector index = tag id]
+        std::vector<std::vector<int>> m_filtersPerTag;
+        // [Vector index = group id]
+        std::vector<std::vector<int>> m_filtersPerGroup;
+        GroupMask m_indexedGroups;
+        // Filters only requiring components, one entry per different signature
+        std::vector<std::pair<Signature, std::vector<int>>> m_filtersPerSignature;
+        // Empty filters match every entity, there is one at most
+        int m_emptyFilter = -1;
+
+        std::vector<std::unique_ptr<Batch>> m_spareBatches;
+
+        // Filters of a tag or group id, the table grows to the id
+        static std::vector<int>& GetKeyFilters(std::vector<std::vector<int>>& filtersPerKey, int key) {
+            if (key >= static_cast<int>(filtersPerKey.size())) {
+                filtersPerKey.resize(key + 1);
+            }
+            return filtersPerKey[key];
+        }
+
+        void IndexSide(int route, int side) {
+            const EntityFilter& filter = m_routes[route].filter[side];
+            const RouteSide routeSide = { route, side };
+            for (auto& indexedFilter: m_filters) {
+                if (indexedFilter.filter == filter) {
+                    indexedFilter.sides.push_back(routeSide);
+                    return;
+                }
+            }
+            const int filterIndex = static_cast<int>(m_filters.size());
+            m_filters.push_back({ filter, { routeSide } });
+
+            if (filter.IsEntity()) {
+                m_filtersPerEntityId[filter.GetEntity().GetId()].push_back(filterIndex);
+            } else if (filter.GetTag() != -1) {
+                GetKeyFilters(m_filtersPerTag, filter.GetTag()).push_back(filterIndex);
+            } else if (filter.GetGroup() != -1) {
+                GetKeyFilters(m_filtersPerGroup, filter.GetGroup()).push_back(filterIndex);
+                m_indexedGroups.set(filter.GetGroup());
+            } else if (filter.GetSignature().any()) {
+                auto it = std::find_if(m_filtersPerSignature.begin(), m_filtersPerSignature.end(), [&filter](const auto& entry) {
+                    return entry.first == filter.GetSignature();
+                });
+                if (it == m_filtersPerSignature.end()) {
+                    m_filtersPerSignature.emplace_back(filter.GetSignature(), std::vector<int>());
+                    it = m_filtersPerSignature.end() - 1;
+                }
+                it->second.push_back(filterIndex);
+            } else {
+                m_emptyFilter = filterIndex;
+            }
+        }
+
+        void RebuildIndex() {
+            m_filters.clear();
+            m_filtersPerEntityId.clear();
+            m_filtersPerTag.clear();
+            m_filtersPerGroup.clear();
+            m_indexedGroups.reset();
+            m_filtersPerSignature.clear();
+            m_emptyFilter = -1;
+            for (int route = 0; route < static_cast<int>(m_routes.size()); route++) {
+                for (int side = 0; side < NUM_ENTITIES; side++) {
+                    IndexSide(route, side);
+                }
+            }
+        }
+
+        // Appends the filters that could match the entity, the keyed ones only when it is alive
+        void AddCandidates(Entity entity, Batch& batch) const {
+            if (!entity.m_registry || !entity.IsAlive()) {
+                return;
+            }
+            const Registry& registry = *entity.m_registry;
+            if (!m_filtersPerEntityId.empty()) {
+                const auto it = m_filtersPerEntityId.find(entity.GetId());
+                if (it != m_filtersPerEntityId.end()) {
+                    batch.candidates.push_back(&it->second);
+                }
+            }
+            const TagId tag = registry.GetEntityTag(entity);
+            if (tag != -1 && tag < static_cast<int>(m_filtersPerTag.size()) && !m_filtersPerTag[tag].empty()) {
+                batch.candidates.push_back(&m_filtersPerTag[tag]);
+            }
+            // Only the groups of the entity that some filter wants
+            uint64_t groups = (registry.GetEntityGroups(entity) & m_indexedGroups).to_ullong();
+            for (GroupId group = 0; groups != 0; group++, groups >>= 1) {
+                if (groups & 1) {
+                    batch.candidates.push_back(&m_filtersPerGroup[group]);
+                }
+            }
+            for (const auto& entry: m_filtersPerSignature) {
+                if ((registry.GetEntitySignature(entity) & entry.first) == entry.first) {
+                    batch.candidates.push_back(&entry.second);
+                }
+            }
+        }
+
+        static void SetMatches(const IndexedFilter& indexedFilter, int i, Batch& batch) {
+            for (const auto& routeSide: indexedFilter.sides) {
+                auto& matches = batch.matches[routeSide.route];
+                if (matches == 0) {
+                    batch.matchingRoutes.push_back(routeSide.route);
+                }
+                matches |= 1u << (routeSide.side * NUM_ENTITIES + i);
+            }
+        }
+
+        // Appends the event to the batches of the routes its entities matched
+        void RouteEvent(TEvent& event, Batch& batch) const {
+            // Every entity of the event is taken by one side of a route, in either order
+            batch.candidates.clear();
+            for (int i = 0; i < NUM_ENTITIES; i++) {
+                batch.firstCandidates[i] = batch.candidates.size();
+                AddCandidates(Entities::GetEntity(event, i), batch);
+                if (batch.candidates.size() == batch.firstCandidates[i] && m_emptyFilter == -1) {
+                    return;
+                }
+            }
+            batch.firstCandidates[NUM_ENTITIES] = batch.candidates.size();
+
+            for (int i = 0; i < NUM_ENTITIES; i++) {
+                Entity entity = Entities::GetEntity(event, i);
+                if (m_emptyFilter != -1) {
+                    SetMatches(m_filters[m_emptyFilter], i, batch);
+                }
+                for (size_t candidate = batch.firstCandidates[i]; candidate < batch.firstCandidates[i + 1]; candidate++) {
+                    for (const int filterIndex: *batch.candidates[candidate]) {
+                        const IndexedFilter& indexedFilter = m_filters[filterIndex];
+                        if (indexedFilter.filter.MatchesAlive(entity, *entity.m_registry)) {
+                            SetMatches(indexedFilter, i, batch);
+                        }
+                    }
+                }
+            }
+
+            for (const int route: batch.matchingRoutes) {
+                const uint32_t matches = batch.matches[route];
+                batch.matches[route] = 0;
+
+                bool isInOrder = true;
+                for (int side = 0; side < NUM_ENTITIES; side++) {
+                    isInOrder = isInOrder && (matches & (1u << (side * NUM_ENTITIES + side)));
+                }
+                if (isInOrder) {
+                    batch.routedEvents[route].push_back(event);
+                }
+                if constexpr (Entities::isSymmetric && NUM_ENTITIES == 2) {
+                    // Side 0 matches entity 1 and side 1 matches entity 0
+                    if ((matches & 0b0110) == 0b0110) {
+                        auto& routedEvents = batch.routedEvents[route];
+                        routedEvents.push_back(event);
+                        std::swap(Entities::GetEntity(routedEvents.back(), 0), Entities::GetEntity(routedEvents.back(), 1));
+                    }
+                }
+            }
+            batch.matchingRoutes.clear();
+        }
+
+        // Applies the changes made by the handlers while the last dispatch was running
+        void EndDispatch() {
+            if (--m_numDispatching > 0 || (!m_hasRemovedRoutes && m_addedRoutes.empty())) {
+                return;
+            }
+            if (m_hasRemovedRoutes) {
+                m_routes.erase(std::remove_if(m_routes.begin(), m_routes.end(), [](const Route& route) { return route.id == 0; }), m_routes.end());
+                m_hasRemovedRoutes = false;
+            }
+            for (auto& route: m_addedRoutes) {
+                m_routes.push_back(std::move(route));
+            }
+            m_addedRoutes.clear();
+            RebuildIndex();
+        }
+
+    public:
+        void Add(SubscriptionId id, const EventFilter<TEvent>& filter, std::function<void(EventSpan<TEvent>)> callback) {
+            Route route = { id, filter, std::move(callback) };
+            if (m_numDispatching > 0) {
+                m_addedRoutes.push_back(std::move(route));
+                return;
+            }
+            m_routes.push_back(std::move(route));
+            for (int side = 0; side < NUM_ENTITIES; side++) {
+                IndexSide(static_cast<int>(m_routes.size()) - 1, side);
+            }
+        }
+
+        void Remove(SubscriptionId id) override {
+            for (auto it = m_addedRoutes.begin(); it != m_addedRoutes.end(); it++) {
+                if (it->id == id) {
+                    m_addedRoutes.erase(it);
+                    return;
+                }
+            }
+            for (auto it = m_routes.begin(); it != m_routes.end(); it++) {
+                if (it->id == id) {
+                    if (m_numDispatching > 0) {
+                        it->id = 0;
+                        m_hasRemovedRoutes = true;
+                    } else {
+                        m_routes.erase(it);
+                        RebuildIndex();
+                    }
+                    return;
+                }
+            }
+        }
+
+        // Hands every route the events of the batch that match its filters, routes in the order they subscribed
+        void Dispatch(TEvent* events, size_t numEvents) {
+            if (m_routes.empty()) {
+                return;
+            }
+            std::unique_ptr<Batch> batch;
+            if (m_spareBatches.empty()) {
+                batch = std::make_unique<Batch>();
+            } else {
+                batch = std::move(m_spareBatches.back());
+                m_spareBatches.pop_back();
+            }
+            m_numDispatching++;
+
+            const size_t numRoutes = m_routes.size();
+            batch->matches.resize(numRoutes, 0);
+            batch->routedEvents.resize(numRoutes);
+            for (size_t i = 0; i < numEvents; i++) {
+                RouteEvent(events[i], *batch);
+            }
+            for (size_t route = 0; route < numRoutes; route++) {
+                auto& routedEvents = batch->routedEvents[route];
+                if (!routedEvents.empty() && m_routes[route].id != 0) {
+                    m_routes[route].callback(EventSpan<TEvent>(routedEvents.data(), routedEvents.size()));
+                }
+                routedEvents.clear();
+            }
+
+            m_spareBatches.push_back(std::move(batch));
+            EndDispatch();
+        }
+};
+
+class EventBus {
+    private:
+        // Shared with the Subscriptions, so the ones outliving the bus know it is gone
+        std::shared_ptr<EventHandlers> m_handlers;
+
+        // [Array index = event id], created by the first QueueEvent of the type
+        std::array<std::atomic<IEventQueue*>, MAX_EVENT_TYPES> m_queues;
+        std::vector<std::unique_ptr<IEventQueue>> m_ownedQueues;
+        std::mutex m_queuesMutex;
+
+        template <typename TEvent>
+        EventQueue<TEvent>& GetQueue() {
+            auto& queue = m_queues[EventType<TEvent>::GetId()];
+            IEventQueue* eventQueue = queue.load(std::memory_order_acquire);
+            if (!eventQueue) {
+                // Several threads can queue the first event of a type at the same time
+                std::lock_guard<std::mutex> lock(m_queuesMutex);
+                eventQueue = queue.load(std::memory_order_relaxed);
+                if (!eventQueue) {
+                    m_ownedQueues.push_back(std::make_unique<EventQueue<TEvent>>());
+                    eventQueue = m_ownedQueues.back().get();
+                    queue.store(eventQueue, std::memory_order_release);
+                }
+            }
+            return static_cast<EventQueue<TEvent>&>(*eventQueue);
+        }
+
+    public:
+        EventBus(): m_handlers(std::make_shared<EventHandlers>()) {
+            for (auto& queue: m_queues) {
+                queue.store(nullptr, std::memory_order_relaxed);
+            }
         }
 
         //////////////////////////////////////////////////////
         // Subscribe to an event <t>
-        // In our implementation a listener subscribes to an event
-        // eventbus->SubscribeToEvenet<CollisionEvent>(this, &Game::onCollision)
+        // In our implementation a listener subscribes to an event once, and keeps the subscription
+        // m_collisionSubscription = eventbus->SubscribeToEvent<CollisionEvent>(this, &Game::onCollision)
+        //////////////////////////////////////////////////////
+        template <typename TEvent, typename TOwner>
+        [[nodiscard]] Subscription SubscribeToEvent(TOwner* ownerInstance, void (TOwner::*callbackFunction)(TEvent&)) {
+            return SubscribeToEvent<TEvent>([ownerInstance, callbackFunction](TEvent& event) {
+                std::invoke(callbackFunction, ownerInstance, event);
+            });
+        }
+
+        // Same with any callable, ex: eventBus->SubscribeToEvent<KeyPressedEvent>([](KeyPressedEvent& event) {...});
+        template <typename TEvent, typename TFunc>
+        [[nodiscard]] Subscription SubscribeToEvent(TFunc callback) {
+            return SubscribeToEventBatches<TEvent>([callback](EventSpan<TEvent> events) mutable {
+                for (auto& event: events) {
+                    callback(event);
+                }
+            });
+        }
+
+        // The handler receives all the queued events of the type at once, in the order they were
+        // queued, and emitted events one at a time
+        // m_collisionSubscription = eventbus->SubscribeToEventBatches<CollisionEvent>(this, &DamageSystem::OnCollisions)
+        template <typename TEvent, typename TOwner>
+        [[nodiscard]] Subscription SubscribeToEventBatches(TOwner* ownerInstance, void (TOwner::*callbackFunction)(EventSpan<TEvent>)) {
+            return SubscribeToEventBatches<TEvent>([ownerInstance, callbackFunction](EventSpan<TEvent> events) {
+                std::invoke(callbackFunction, ownerInstance, events);
+            });
+        }
+
+        //////////////////////////////////////////////////////
+        // Subscribe to the events about some entities only
+        // The handler only receives the events whose entities match the filter, the other ones never
+        // reach it. The entities of a symmetric event are swapped when needed, so the first entity
+        // always matches the first filter, and an event matching in both orders is received in both
+        // (see EventRouter). ex: projectiles hitting something with health
+        // eventBus->SubscribeToEventBatches<CollisionEvent>({ EntityFilter().Require<ProjectileComponent>(), EntityFilter().Require<HealthComponent>() },
+        //     this, &DamageSystem::OnProjectileHits);
         //////////////////////////////////////////////////////
         template <typename TEvent, typename TOwner>
-        void SubscribeToEvent(TOwner* ownerInstance, void (TOwner::*callbackFunction)(TEvent&)) {
+        [[nodiscard]] Subscription SubscribeToEventBatches(const EventFilter<TEvent>& filter, TOwner* ownerInstance, void (TOwner::*callbackFunction)(EventSpan<TEvent>)) {
+            return SubscribeToEventBatches<TEvent>(filter, [ownerInstance, callbackFunction](EventSpan<TEvent> events) {
+                std::invoke(callbackFunction, ownerInstance, events);
+            });
+        }
+
+        template <typename TEvent, typename TFunc>
+        [[nodiscard]] Subscription SubscribeToEventBatches(const EventFilter<TEvent>& filter, TFunc callback) {
+            static_assert(EventEntities<TEvent>::numEntities > 0, "Only the events specializing EventEntities can be filtered by entity");
 
-            if (m_subscribers[typeid(TEvent)].get() == nullptr) {
-                m_subscribers[typeid(TEvent)] = std::make_unique<HandlerList>();
+            // The router of the type is subscribed once, as a handler, by the first filtered subscription
+            const int eventId = EventType<TEvent>::GetId();
+            auto& router = m_handlers->routers[eventId];
+            if (!router) {
+                router = std::make_unique<EventRouter<TEvent>>();
+                EventRouter<TEvent>* eventRouter = static_cast<EventRouter<TEvent>*>(router.get());
+                m_handlers->lists[eventId].Add({ m_handlers->nextSubscriptionId++, [eventRouter](void* events, size_t numEvents) {
+                    eventRouter->Dispatch(static_cast<TEvent*>(events), numEvents);
+                }});
             }
-            auto subscriber = std::make_unique<EventCallBack<TOwner, TEvent>>(ownerInstance, callbackFunction);
-            m_subscribers[typeid(TEvent)]->push_back(std::move(subscriber));
+            const SubscriptionId id = m_handlers->nextSubscriptionId++;
+            static_cast<EventRouter<TEvent>&>(*router).Add(id, filter, std::function<void(EventSpan<TEvent>)>(std::move(callback)));
+            return Subscription(m_handlers, eventId, id);
+        }
+
+        template <typename TEvent, typename TFunc>
+        [[nodiscard]] Subscription SubscribeToEventBatches(TFunc callback) {
+            const int eventId = EventType<TEvent>::GetId();
+            const SubscriptionId id = m_handlers->nextSubscriptionId++;
+            m_handlers->lists[eventId].Add({ id, [callback](void* events, size_t numEvents) mutable {
+                callback(EventSpan<TEvent>(static_cast<TEvent*>(events), numEvents));
+            }});
+            return Subscription(m_handlers, eventId, id);
         }
 
         //////////////////////////////////////////////////////
@@ -86,15 +926,40 @@ class EventBus {
         //////////////////////////////////////////////////////
         template <typename TEvent, typename ...TArgs>
         void EmitEvent(TArgs&& ...args) {
-            auto handlers = m_subscribers[typeid(TEvent)].get();
-            if (handlers) {
-                for (auto it = handlers->begin(); it != handlers->end(); it++) {
-                    auto handler = it->get();
-                    TEvent event(std::forward<TArgs>(args)...);
-                    handler->Execute(event);
-                };
+            auto& list = m_handlers->lists[EventType<TEvent>::GetId()];
+            if (list.handlers.empty()) {
+                return;
+            }
+
+            // Built once, every handler sees the same event
+            TEvent event(std::forward<TArgs>(args)...);
+            list.Emit(&event, 1);
+        }
+
+        //////////////////////////////////////////////////////
+        // Queue an event of type <T>
+        // the handlers receive it at the next DispatchQueuedEvents(), with the other events of
+        // the type. Can be called from any thread, ex: by a system running on the scheduler.
+        //////////////////////////////////////////////////////
+        template <typename TEvent, typename ...TArgs>
+        void QueueEvent(TArgs&& ...args) {
+            GetQueue<TEvent>().Push(std::forward<TArgs>(args)...);
+        }
+
+        // Hands the queued events to their handlers, one event type after the other in the order
+        // of the EventManifest. Must be called on the main thread while nothing queues events
+        // (Game::Update calls it after the systems). Events queued by the handlers are dispatched
+        // next time.
+        // The events with an EventOrder are handed in the order of their key, so the handlers run
+        // the same way whatever the number of threads the systems run on.
+        void DispatchQueuedEvents() {
+            for (int eventId = 0; eventId < static_cast<int>(MAX_EVENT_TYPES); eventId++) {
+                IEventQueue* eventQueue = m_queues[eventId].load(std::memory_order_acquire);
+                if (eventQueue) {
+                    eventQueue->Dispatch(m_handlers->lists[eventId]);
+                }
             }
         }
 };
 
-#endif
\ No newline at end of file
+#endif
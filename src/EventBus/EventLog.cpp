@@ -0,0 +1,153 @@
+#include "EventLog.h"
+#include "../Events/KeyPressedEvent.h"
+#include "../Events/ShootProjectileEvent.h"
+#include "../Logger/Logger.h"
+#include "../Snapshot/Snapshot.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+    const char MAGIC[4] = { 'E', 'V', 'L', 'G' };
+
+    // 7 bits per byte, the high bit tells that another byte follows: most frame gaps take one byte
+    void WriteVarint(SnapshotWriter& writer, uint32_t value) {
+        while (value >= 0x80) {
+            writer.Write(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        writer.Write(static_cast<uint8_t>(value));
+    }
+
+    uint32_t ReadVarint(SnapshotReader& reader) {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 35 && reader.IsValid(); shift += 7) {
+            const auto byte = reader.Read<uint8_t>();
+            value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+        return value;
+    }
+}
+
+void EventLog::Record(uint32_t frame, LoggedEventType type, int32_t keySymbol) {
+    m_events.push_back({ frame, type, keySymbol });
+}
+
+void EventLog::RecordKeyPressed(uint32_t frame, SDL_Keycode symbol) {
+    Record(frame, KEY_PRESSED, static_cast<int32_t>(symbol));
+}
+
+void EventLog::RecordShootProjectile(uint32_t frame) {
+    Record(frame, SHOOT_PROJECTILE, 0);
+}
+
+void EventLog::EmitFrameEvents(uint32_t frame, std::unique_ptr<EventBus>& eventBus, std::unique_ptr<Registry>& registry) {
+    // Same order as Game::ProcessInput emitted them
+    for (; m_nextEvent < m_events.size() && m_events[m_nextEvent].frame <= frame; m_nextEvent++) {
+        const auto& event = m_events[m_nextEvent];
+        if (event.frame < frame) {
+            continue;
+        }
+        switch (event.type) {
+            case KEY_PRESSED:
+                eventBus->EmitEvent<KeyPressedEvent>(static_cast<SDL_Keycode>(event.keySymbol));
+                break;
+            case SHOOT_PROJECTILE:
+                eventBus->EmitEvent<ShootProjectileEvent>(registry);
+                break;
+        }
+    }
+}
+
+std::vector<char> EventLog::Save() const {
+    SnapshotWriter writer;
+    writer.Write(MAGIC, sizeof(MAGIC));
+    writer.Write(FORMAT_VERSION);
+    writer.Write(m_fixedDeltaTime);
+    writer.Write(m_numFrames);
+    writer.Write(static_cast<uint32_t>(m_events.size()));
+
+    uint32_t previousFrame = 0;
+    for (const auto& event: m_events) {
+        WriteVarint(writer, event.frame - previousFrame);
+        writer.Write(static_cast<uint8_t>(event.type));
+        if (event.type == KEY_PRESSED) {
+            WriteVarint(writer, static_cast<uint32_t>(event.keySymbol));
+        }
+        previousFrame = event.frame;
+    }
+    return writer.Release();
+}
+
+bool EventLog::SaveToFile(const std::string& path) const {
+    const auto blob = Save();
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(blob.data(), blob.size());
+    if (!file) {
+        Logger::Error("Could not write the event log " + path);
+        return false;
+    }
+    Logger::Log("Event log saved to " + path + " (" + std::to_string(m_events.size()) + " events, " + std::to_string(m_numFrames) + " frames, " + std::to_string(blob.size()) + " bytes)");
+    return true;
+}
+
+bool EventLog::Load(const char* data, size_t size) {
+    SnapshotReader reader(data, size, nullptr);
+    char magic[sizeof(MAGIC)];
+    reader.Read(magic, sizeof(magic));
+    if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || reader.Read<uint32_t>() != FORMAT_VERSION) {
+        Logger::Error("Not an event log, or an event log of an older format");
+        return false;
+    }
+    const auto fixedDeltaTime = reader.Read<double>();
+    const auto numFrames = reader.Read<uint32_t>();
+    const auto numEvents = reader.Read<uint32_t>();
+    // Every event takes two bytes at least
+    if (numEvents > size / 2) {
+        Logger::Error("Event log has an invalid number of events");
+        return false;
+    }
+
+    std::vector<LoggedEvent> events;
+    events.reserve(numEvents);
+    uint32_t frame = 0;
+    for (uint32_t i = 0; i < numEvents && reader.IsValid(); i++) {
+        frame += ReadVarint(reader);
+        const auto type = reader.Read<uint8_t>();
+        if (type == KEY_PRESSED) {
+            events.push_back({ frame, KEY_PRESSED, static_cast<int32_t>(ReadVarint(reader)) });
+        } else if (type == SHOOT_PROJECTILE) {
+            events.push_back({ frame, SHOOT_PROJECTILE, 0 });
+        } else {
+            Logger::Error("Event log has an unknown event type");
+            return false;
+        }
+    }
+    if (!reader.IsValid() || !reader.IsAtEnd()) {
+        Logger::Error("Event log is truncated or damaged");
+        return false;
+    }
+
+    m_events = std::move(events);
+    m_numFrames = numFrames;
+    m_fixedDeltaTime = fixedDeltaTime;
+    m_nextEvent = 0;
+    return true;
+}
+
+bool EventLog::LoadFromFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        Logger::Error("Could not open the event log " + path);
+        return false;
+    }
+    const std::vector<char> blob((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!Load(blob.data(), blob.size())) {
+        return false;
+    }
+    Logger::Log("Event log loaded from " + path + " (" + std::to_string(m_events.size()) + " events, " + std::to_string(m_numFrames) + " frames)");
+    return true;
+}
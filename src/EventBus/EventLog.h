@@ -0,0 +1,78 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include "../ECS/ECS.h"
+#include "./EventBus.h"
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////
+// EventLog
+////////////////////////////////////////////////////////////////////////////////////
+//// The events coming from outside the simulation during a session (the keyboard:
+//// KeyPressedEvent and ShootProjectileEvent), with the frame they were emitted in.
+//// The Game records them from the EventBus (--record) and a replay (--replay) emits them
+//// again at the same frames, which plays the same session without anybody at the keyboard,
+//// to profile a build or compare two of them.
+//// The file is a small header followed, for every event, by the frames since the previous
+//// event as a varint, a byte for the event type and the key symbol of the KeyPressedEvents.
+//// A replay only plays the same game with the fixed delta time it was recorded with (see
+//// GameClock), the log keeps it in its header.
+////////////////////////////////////////////////////////////////////////////////////
+
+class EventLog {
+    private:
+        // To bump when the file layout changes
+        static constexpr uint32_t FORMAT_VERSION = 1;
+
+        // Written in the file, they do not follow the EventManifest so it can change
+        enum LoggedEventType: uint8_t {
+            KEY_PRESSED = 0,
+            SHOOT_PROJECTILE = 1
+        };
+
+        struct LoggedEvent {
+            uint32_t frame;
+            LoggedEventType type;
+            // KeyPressedEvent only
+            int32_t keySymbol;
+        };
+
+        std::vector<LoggedEvent> m_events;
+
+        // Frames of the recorded session, a replay ends after the last one
+        uint32_t m_numFrames = 0;
+        // 0 when the session was recorded with the measured delta time
+        double m_fixedDeltaTime = 0;
+
+        // Next event to emit, the replay moves through the frames in order
+        size_t m_nextEvent = 0;
+
+        void Record(uint32_t frame, LoggedEventType type, int32_t keySymbol);
+
+    public:
+        void RecordKeyPressed(uint32_t frame, SDL_Keycode symbol);
+        void RecordShootProjectile(uint32_t frame);
+
+        // Emits on the bus the events logged for this frame, frames are replayed in increasing order
+        void EmitFrameEvents(uint32_t frame, std::unique_ptr<EventBus>& eventBus, std::unique_ptr<Registry>& registry);
+
+        void SetNumFrames(uint32_t numFrames) { m_numFrames = numFrames; }
+        uint32_t GetNumFrames() const { return m_numFrames; }
+        void SetFixedDeltaTime(double fixedDeltaTime) { m_fixedDeltaTime = fixedDeltaTime; }
+        double GetFixedDeltaTime() const { return m_fixedDeltaTime; }
+        size_t GetNumEvents() const { return m_events.size(); }
+
+        std::vector<char> Save() const;
+        bool SaveToFile(const std::string& path) const;
+
+        // Replaces the logged events by the ones of the blob, returns false leaving the log
+        // untouched when the blob is not an event log of this format or is truncated
+        bool Load(const char* data, size_t size);
+        bool LoadFromFile(const std::string& path);
+};
+
+#endif
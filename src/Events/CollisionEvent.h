@@ -12,4 +12,25 @@ class CollisionEvent : public Event{
         CollisionEvent(Entity a, Entity b): a(a), b(b) {}
 };
 
+// A pair of entities collides once per frame, the ids of the pair order the collisions
+template <>
+struct EventOrder<CollisionEvent> {
+    static constexpr bool isOrdered = true;
+
+    static uint64_t GetKey(const CollisionEvent& event) {
+        return (static_cast<uint64_t>(event.a.GetId()) << 32) | static_cast<uint32_t>(event.b.GetId());
+    }
+};
+
+// Either entity of a collision can be a or b
+template <>
+struct EventEntities<CollisionEvent> {
+    static constexpr int numEntities = 2;
+    static constexpr bool isSymmetric = true;
+
+    static Entity& GetEntity(CollisionEvent& event, int index) {
+        return index == 0 ? event.a : event.b;
+    }
+};
+
 #endif
\ No newline at end of file
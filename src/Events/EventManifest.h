@@ -0,0 +1,19 @@
+#ifndef EVENTMANIFEST_H
+#define EVENTMANIFEST_H
+
+// Every event type used with the EventBus. The position of a type in the list is its event id,
+// the index of its handlers in the bus.
+// This file is included by EventBus.h, the event types only need to be declared here.
+// To add an event: declare it bellow and append it to the list.
+
+class CollisionEvent;
+class KeyPressedEvent;
+class ShootProjectileEvent;
+
+typedef EventList<
+    CollisionEvent,
+    KeyPressedEvent,
+    ShootProjectileEvent
+> EventManifest;
+
+#endif
@@ -2,6 +2,7 @@
 #include "../ECS/ECS.h"
 #include "../Logger/Logger.h"
 #include "./LevelLoader.h"
+#include "./GameClock.h"
 #include "../Systems/MovementSystem.h"
 #include "../Systems/RenderSystem.h"
 #include "../Systems/AnimationSystem.h"
@@ -16,6 +17,10 @@
 #include "../Systems/RenderHealthBarSystem.h"
 #include "../Systems/RenderGUISystem.h"
 #include "../Systems/LuaScriptSystem.h"
+#include "../Systems/SleepSystem.h"
+#include "../Systems/HierarchySystem.h"
+#include "../Snapshot/Snapshot.h"
+#include <chrono>
 #include <iostream>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
@@ -31,7 +36,7 @@ int Game::m_mapWidth;
 
 
 // Constructor
-Game::Game(){
+Game::Game(const GameOptions& options): m_options(options) {
     m_isRunning = false;
     m_isDebug = false;
 
@@ -39,6 +44,8 @@ Game::Game(){
     m_registry = std::make_unique<Registry>();
     m_assetStore = std::make_unique<AssetStore>();
     m_eventBus = std::make_unique<EventBus>();
+    m_scheduler = std::make_unique<SystemScheduler>();
+    m_frameArena = std::make_unique<FrameArena>(FRAME_ARENA_CAPACITY);
     Logger::Log("Game constructor called");
 };
 
@@ -49,22 +56,66 @@ Game::~Game(){
 };
 
 // Create an SDL Window and Renderer.
-void Game::Initialize(){
+bool Game::Initialize(){
+    if (IsReplaying()) {
+        m_eventLog = std::make_unique<EventLog>();
+        if (!m_eventLog->LoadFromFile(m_options.replayPath)) {
+            return false;
+        }
+    } else if (!m_options.recordPath.empty()) {
+        m_eventLog = std::make_unique<EventLog>();
+    }
+
+    // A replay steps like its recording, a recording without fixed step can not be replayed exactly
+    m_fixedDeltaTime = m_options.fixedDeltaTime;
+    if (IsReplaying() && m_fixedDeltaTime <= 0) {
+        m_fixedDeltaTime = m_eventLog->GetFixedDeltaTime();
+        if (m_fixedDeltaTime <= 0) {
+            Logger::Error("Event log recorded without a fixed delta time, the replay may not play the same game");
+            m_fixedDeltaTime = MILLISECS_PER_FRAME / 1000.0;
+        }
+    }
+    if (m_fixedDeltaTime > 0) {
+        GameClock::StartFixedStep();
+    }
+    if (m_eventLog && !IsReplaying()) {
+        m_eventLog->SetFixedDeltaTime(m_fixedDeltaTime);
+    }
+
+    // Same view as with a window, the camera decides which entities sleep
+    m_windowWidth = 2560;
+    m_windowHeight = 1080;
+    m_camera = { 0, 0, m_windowWidth, m_windowHeight };
+
+    if (m_options.isHeadless) {
+        // The fonts are still loaded by the level, the textures are not (see AssetStore::AddTexture)
+        if (SDL_Init(SDL_INIT_TIMER) != 0) {
+            Logger::Error("Error initializing SDL Init.");
+            return false;
+        }
+        m_isSdlInitialized = true;
+        if (TTF_Init() != 0) {
+            Logger::Error("Error initializing SDL TTF.");
+            return false;
+        }
+        m_isRunning = true;
+        return true;
+    }
+
     if(SDL_Init(SDL_INIT_EVERYTHING) != 0) {
         Logger::Error("Error initializing SDL Init.");
-        return;
+        return false;
     }
+    m_isSdlInitialized = true;
 
     if (TTF_Init() != 0) {
         Logger::Error("Error initializing SDL TTF.");
-        return;
+        return false;
     }
 
     // Getting window sizes
     SDL_DisplayMode displayMode;
     SDL_GetCurrentDisplayMode(0, &displayMode);
-    m_windowWidth = 2560;
-    m_windowHeight = 1080;
 
     m_ptrWindow = SDL_CreateWindow(
         NULL, 
@@ -77,27 +128,26 @@ void Game::Initialize(){
 
     if (!m_ptrWindow) {
         Logger::Error("Error creating SDL Window.");
-        return;
+        return false;
     }
 
     m_ptrRenderer = SDL_CreateRenderer(m_ptrWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
 
     if (!m_ptrRenderer) {
         Logger::Error("Error creating SDL Renderer.");
-        return;
+        return false;
     }
 
     SDL_SetWindowFullscreen(m_ptrWindow, SDL_WINDOW_FULLSCREEN);
 
-    //Initialize the camera view with the entire screen area
-    m_camera = { 0, 0, m_windowWidth, m_windowHeight };
-
     // Initialize the ImGui with SDL2 context
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGuiSDL::Initialize(m_ptrRenderer, m_windowWidth, m_windowHeight);
+    m_hasImGui = true;
 
     m_isRunning = true;
+    return true;
 };
 
 void Game::Setup(){
@@ -117,6 +167,45 @@ void Game::Setup(){
     m_registry->AddSystem<RenderHealthBarSystem>();
     m_registry->AddSystem<RenderGUISystem>();
     m_registry->AddSystem<LuaScriptSystem>();
+    m_registry->AddSystem<SleepSystem>();
+    m_registry->AddSystem<HierarchySystem>();
+
+    // Keep the transform and sprite pools sorted together, the RenderSystem walks them every frame
+    m_registry->CreateOwningGroup<TransformComponent, SpriteComponent>();
+
+    // Schedule the update systems, in the order they must keep when their component access conflicts
+    m_scheduler->AddSystem<MovementSystem>("Movement", m_registry, [this](MovementSystem& system) { system.Update(m_registry, m_deltaTime, m_scheduler->GetWorkerPool()); });
+    m_scheduler->AddSystem<AnimationSystem>("Animation", m_registry, [this](AnimationSystem& system) { system.Update(m_scheduler->GetWorkerPool()); });
+    m_scheduler->AddSystem<ProjectileLifeCycleSystem>("ProjectileLifeCycle", m_registry, [](ProjectileLifeCycleSystem& system) { system.Update(); });
+    m_scheduler->AddSystem<CameraMovementSystem>("CameraMovement", m_registry, [this](CameraMovementSystem& system) { system.Update(m_camera); });
+    m_scheduler->AddSystem<ProjectileEmitSystem>("ProjectileEmit", m_registry, [this](ProjectileEmitSystem& system) { system.Update(m_registry); });
+    m_scheduler->AddSystem<CollisionSystem>("Collision", m_registry, [this](CollisionSystem& system) { system.Update(false, m_registry, m_eventBus); });
+    m_scheduler->AddSystem<LuaScriptSystem>("LuaScript", m_registry, [this](LuaScriptSystem& system) { system.Update(m_deltaTime, GameClock::GetTicks()); });
+
+    // The enemies and tiles far away from the camera sleep until the camera gets close
+    m_registry->GetSystem<SleepSystem>().AddSleepingGroup("enemies");
+    m_registry->GetSystem<SleepSystem>().AddSleepingGroup("tiles");
+
+    // Event subscriptions of the systems, they last as long as the systems
+    m_registry->GetSystem<DamageSystem>().SubscribeToCollisionEvent(m_eventBus);
+    m_registry->GetSystem<MovementSystem>().SubscribeToCollisionEvent(m_eventBus);
+    m_registry->GetSystem<KeyboardControlSystem>().SubscribeToKeyPressedEvents(m_eventBus);
+    m_registry->GetSystem<ProjectileEmitSystem>().SubscribeToSpaceBarEvent(m_eventBus);
+
+    // Record the input events with the frame they happen in
+    if (m_eventLog && !IsReplaying()) {
+        m_keyPressedRecording = m_eventBus->SubscribeToEvent<KeyPressedEvent>([this](KeyPressedEvent& event) {
+            m_eventLog->RecordKeyPressed(m_frame, event.symbol);
+        });
+        m_shootProjectileRecording = m_eventBus->SubscribeToEvent<ShootProjectileEvent>([this](ShootProjectileEvent&) {
+            m_eventLog->RecordShootProjectile(m_frame);
+        });
+    }
+
+    // Component observers of the systems that cache per entity data
+    m_registry->GetSystem<RenderTextSystem>().ObserveTextLabels(m_registry);
+    m_registry->GetSystem<HierarchySystem>().ObserveHierarchy(m_registry);
+    m_registry->GetSystem<SleepSystem>().ObserveTransforms(m_registry);
 
     //Create the binding between C++ and LUA
     m_registry->GetSystem<LuaScriptSystem>().CreateLuaBindings(m_lua);
@@ -129,80 +218,126 @@ void Game::Setup(){
 
 void Game::Update(){
     
-    //Time to wait
+    //Time to wait, a headless game runs as fast as it can
     int timeToWait = MILLISECS_PER_FRAME - (SDL_GetTicks() - m_millisecsPreviousFrame);
-    if (timeToWait > 0 && timeToWait <= MILLISECS_PER_FRAME) {
+    if (!m_options.isHeadless && timeToWait > 0 && timeToWait <= MILLISECS_PER_FRAME) {
         // Clamp to the target time each frame should take based on our target FPS.
         SDL_Delay(timeToWait);
     }
 
-    // The diff in ticks since the last frame, converted to seconds.
-    double deltaTime = (SDL_GetTicks() - m_millisecsPreviousFrame)/ 1000.0;
+    if (m_fixedDeltaTime > 0) {
+        // Same step every frame, how long the frames take does not change the simulation
+        m_deltaTime = m_fixedDeltaTime;
+        GameClock::Advance(m_deltaTime);
+    } else {
+        // The diff in ticks since the last frame, converted to seconds.
+        m_deltaTime = (SDL_GetTicks() - m_millisecsPreviousFrame)/ 1000.0;
+    }
 
     // How many millisecs have passed?
     m_millisecsPreviousFrame = SDL_GetTicks();  
 
-    //Reset all event handlers
-    m_eventBus->ClearSubscribers();
+    // Updating our systems, independent ones run at the same time
+    m_scheduler->Run();
 
-    // Perform the subscribtion of the events for all systems
-    m_registry->GetSystem<DamageSystem>().SubscribeToCollisionEvent(m_eventBus);
-    m_registry->GetSystem<MovementSystem>().SubscribeToCollisionEvent(m_eventBus);
-    m_registry->GetSystem<KeyboardControlSystem>().SubscribeToKeyPressedEvents(m_eventBus);
-    m_registry->GetSystem<ProjectileEmitSystem>().SubscribeToSpaceBarEvent(m_eventBus);
+    // Handle the events queued by the systems (collisions, ...) in one batch per event type
+    m_eventBus->DispatchQueuedEvents();
 
-    // Updating our systems
-    m_registry->GetSystem<MovementSystem>().Update(deltaTime);
-    m_registry->GetSystem<AnimationSystem>().Update();
-    m_registry->GetSystem<CollisionSystem>().Update(false, m_eventBus);
-    m_registry->GetSystem<CameraMovementSystem>().Update(m_camera);
-    m_registry->GetSystem<ProjectileEmitSystem>().Update(m_registry);
-    m_registry->GetSystem<ProjectileLifeCycleSystem>().Update();
-    m_registry->GetSystem<LuaScriptSystem>().Update(deltaTime, SDL_GetTicks());
-    
+    // Sleep and wake up entities around the new camera position
+    m_registry->GetSystem<SleepSystem>().Update(m_registry, m_camera);
 
     // Update the registry to process the entities that are in the buffer
     m_registry->Update();
+
+    // Place the children entities where their parent is now, before rendering them
+    m_registry->GetSystem<HierarchySystem>().Update(m_registry);
 };
 
+void Game::SaveCheckpoint() {
+    Snapshot::SaveToFile(*m_registry, CHECKPOINT_PATH);
+}
+
+void Game::LoadCheckpoint() {
+    // The assets and the Lua level are still loaded, only the entities are replaced
+    const bool isLoaded = Snapshot::LoadFromFile(*m_registry, CHECKPOINT_PATH, [this](const std::string& name) {
+        return LevelLoader::FindScript(m_lua, name);
+    });
+    if (isLoaded) {
+        m_registry->GetSystem<SleepSystem>().Reset(m_registry);
+    }
+}
+
 void Game::Render(){
     // Grey background
     SDL_SetRenderDrawColor(m_ptrRenderer, 21, 21, 21, 255);
     SDL_RenderClear(m_ptrRenderer);
 
     // Rendering our systems
-    m_registry->GetSystem<RenderSystem>().Update(m_ptrRenderer, m_assetStore, m_camera);
-    m_registry->GetSystem<RenderTextSystem>().Update(m_ptrRenderer, m_assetStore, m_camera);
+    m_registry->GetSystem<RenderSystem>().Update(m_ptrRenderer, m_registry, m_assetStore, m_camera, *m_frameArena);
+    m_registry->GetSystem<RenderTextSystem>().Update(m_ptrRenderer, m_registry, m_assetStore, m_camera);
     m_registry->GetSystem<RenderHealthBarSystem>().Update(m_ptrRenderer, m_assetStore, m_camera);
 
     // Debug Mode
     if(m_isDebug) {
         m_registry->GetSystem<DebugCollisionSystem>().Update(m_ptrRenderer, m_camera);
 
-        m_registry->GetSystem<RenderGUISystem>().Update(m_registry, m_camera);
+        m_registry->GetSystem<RenderGUISystem>().Update(m_registry, m_camera, m_scheduler->GetLastFrameStats(), m_frameArena->GetLastFrameStats());
     }
 
 
     // Swap back buffer with front buffer.
     SDL_RenderPresent(m_ptrRenderer);
+
+    // Nothing allocated during the frame is used anymore
+    m_frameArena->Reset();
 };
 
 
 // Engine loop
 void Game::Run(){
 
+    // Initialize() failed, there is nothing to run
+    if (!m_isRunning) {
+        return;
+    }
+
     Game::Setup();
 
+    const auto start = std::chrono::steady_clock::now();
     while(m_isRunning) {
         Game::ProcessInput();
         Game::Update();
-        Game::Render();
+        if (!m_options.isHeadless) {
+            Game::Render();
+        } else {
+            m_frameArena->Reset();
+        }
+        m_frame++;
+
+        if (IsReplaying() && m_frame >= m_eventLog->GetNumFrames()) {
+            m_isRunning = false;
+        }
+    }
+    const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (IsReplaying()) {
+        // The numbers to compare between two builds
+        Logger::Log("Replayed " + std::to_string(m_frame) + " frames in " + std::to_string(elapsedMs) + " ms (" + std::to_string(elapsedMs / std::max(m_frame, 1u)) + " ms per frame)");
+    } else if (m_eventLog) {
+        m_eventLog->SetNumFrames(m_frame);
+        m_eventLog->SaveToFile(m_options.recordPath);
     }
 };
 
 void Game::ProcessInput(){
+    // A replay takes its input events from the log, the keyboard can only quit or toggle the debug
+    // mode. The checkpoints (F5 and F9) are not replayed.
+    if (IsReplaying()) {
+        m_eventLog->EmitFrameEvents(m_frame, m_eventBus, m_registry);
+    }
+
     SDL_Event sdlEvent;
-    while (SDL_PollEvent(&sdlEvent)) {
+    while (!m_options.isHeadless && SDL_PollEvent(&sdlEvent)) {
         //Handling Imgui SDL
         ImGui_ImplSDL2_ProcessEvent(&sdlEvent);
         ImGuiIO& io = ImGui::GetIO();
@@ -228,6 +363,15 @@ void Game::ProcessInput(){
             if(sdlEvent.key.keysym.sym == SDLK_F1) {
                 m_isDebug = !m_isDebug;
             }
+            if (IsReplaying()) {
+                break;
+            }
+            if (sdlEvent.key.keysym.sym == SDLK_F5) {
+                SaveCheckpoint();
+            }
+            if (sdlEvent.key.keysym.sym == SDLK_F9) {
+                LoadCheckpoint();
+            }
             if (sdlEvent.key.keysym.sym == SDLK_SPACE) {
                 m_eventBus->EmitEvent<ShootProjectileEvent>(m_registry);
             }
@@ -242,9 +386,23 @@ void Game::ProcessInput(){
 };
 
 void Game::Destroy(){
-    ImGui::DestroyContext();
-    ImGuiSDL::Deinitialize();
-    SDL_DestroyRenderer(m_ptrRenderer);
-    SDL_DestroyWindow(m_ptrWindow);
-    SDL_Quit();
+    // Called by main and again by the destructor, also after an Initialize() that stopped half way
+    // (or headless, without window): only what was created is destroyed, and only once
+    if (m_hasImGui) {
+        ImGui::DestroyContext();
+        ImGuiSDL::Deinitialize();
+        m_hasImGui = false;
+    }
+    if (m_ptrRenderer) {
+        SDL_DestroyRenderer(m_ptrRenderer);
+        m_ptrRenderer = nullptr;
+    }
+    if (m_ptrWindow) {
+        SDL_DestroyWindow(m_ptrWindow);
+        m_ptrWindow = nullptr;
+    }
+    if (m_isSdlInitialized) {
+        SDL_Quit();
+        m_isSdlInitialized = false;
+    }
 };
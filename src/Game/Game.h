@@ -6,29 +6,75 @@
 #include "../ECS/ECS.h"
 #include "../AssetStore/AssetStore.h"
 #include "../EventBus/EventBus.h"
+#include "../Scheduler/SystemScheduler.h"
+#include "../Memory/FrameArena.h"
+#include "../EventBus/EventLog.h"
 
 
 const int FPS = 60;
 const int MILLISECS_PER_FRAME = 1000 / FPS;
 
+// Starting size of the frame arena, it grows by itself when a frame needs more
+const size_t FRAME_ARENA_CAPACITY = 1024 * 1024;
+
+// Written with F5 and loaded back with F9
+const std::string CHECKPOINT_PATH = "checkpoint.snapshot";
+
+// How the game gets its input and its time, set from the command line (see Main.cpp)
+struct GameOptions {
+    // Writes the input events of the session to this file when the game ends, see EventLog
+    std::string recordPath;
+    // Emits the input events of this recording instead of reading the keyboard, and ends after
+    // its last frame. Not with recordPath.
+    std::string replayPath;
+    // No window and no rendering, the frames are not capped to FPS. For replays.
+    bool isHeadless = false;
+    // Seconds of every frame when > 0, instead of the measured time (see GameClock).
+    // A replay uses the one of its recording when it is not set.
+    double fixedDeltaTime = 0;
+};
+
 class Game {
     private:
         sol::state m_lua;
-        SDL_Window* m_ptrWindow;
-        SDL_Renderer* m_ptrRenderer;
+        SDL_Window* m_ptrWindow = nullptr;
+        SDL_Renderer* m_ptrRenderer = nullptr;
         bool m_isRunning = false;
         bool m_isDebug = false;
+        // What Initialize() created, for Destroy()
+        bool m_isSdlInitialized = false;
+        bool m_hasImGui = false;
         int m_millisecsPreviousFrame = 0;
+        double m_deltaTime = 0;
+        double m_fixedDeltaTime = 0;
+        // Frames simulated since the start, the events are recorded and replayed by frame
+        uint32_t m_frame = 0;
         SDL_Rect m_camera;
 
         std::unique_ptr<Registry> m_registry; // Registry* m_registry;
         std::unique_ptr<AssetStore> m_assetStore;
         std::unique_ptr<EventBus> m_eventBus;
 
+        // Runs the update systems in parallel, in the dependency order of their component access
+        std::unique_ptr<SystemScheduler> m_scheduler;
+
+        // Transient memory of the systems, released at the end of every frame
+        std::unique_ptr<FrameArena> m_frameArena;
+
+        GameOptions m_options;
+        // Input events being recorded or replayed, null otherwise
+        std::unique_ptr<EventLog> m_eventLog;
+        // Subscriptions recording the input events
+        Subscription m_keyPressedRecording;
+        Subscription m_shootProjectileRecording;
+
+        bool IsReplaying() const { return !m_options.replayPath.empty(); }
+
     public:
-        Game();
+        Game(const GameOptions& options = GameOptions());
         ~Game();
-        void Initialize();
+        // Returns false when the game can not run (SDL failed, replay file not loaded...)
+        bool Initialize();
         void Destroy();
         void Run();
         void ProcessInput();
@@ -36,6 +82,10 @@ class Game {
         void Render();
         void Setup();
 
+        // Snapshot of the registry, see Snapshot
+        void SaveCheckpoint();
+        void LoadCheckpoint();
+
         static int m_windowWidth;
         static int m_windowHeight;
         static int m_mapWidth;
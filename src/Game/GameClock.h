@@ -0,0 +1,40 @@
+#ifndef GAMECLOCK_H
+#define GAMECLOCK_H
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+
+////////////////////////////////////////////////////////////////////////////////////
+// GameClock
+////////////////////////////////////////////////////////////////////////////////////
+//// Milliseconds of game time, read instead of SDL_GetTicks() by everything that times
+//// the simulation (projectile lifespans, rates of fire, animations, Lua scripts).
+//// It follows SDL_GetTicks() by default. With a fixed step (see GameOptions::fixedDeltaTime)
+//// it only moves by the step at every frame, so a replay gets the same timings however
+//// fast or slow its frames run.
+////////////////////////////////////////////////////////////////////////////////////
+
+class GameClock {
+    private:
+        static inline bool m_isFixedStep = false;
+        static inline double m_millisecs = 0;
+
+    public:
+        static uint32_t GetTicks() {
+            return m_isFixedStep ? static_cast<uint32_t>(m_millisecs) : SDL_GetTicks();
+        }
+
+        // Stops following SDL_GetTicks(), the clock restarts at 0 and only moves with Advance()
+        static void StartFixedStep() {
+            m_isFixedStep = true;
+            m_millisecs = 0;
+        }
+
+        static void Advance(double seconds) {
+            m_millisecs += seconds * 1000.0;
+        }
+
+        static bool IsFixedStep() { return m_isFixedStep; }
+};
+
+#endif
@@ -11,6 +11,7 @@
 #include "../Components/HealthComponent.h"
 #include "../Components/TextLabelComponent.h"
 #include "../Components/LuaScriptComponent.h"
+#include "../Systems/HierarchySystem.h"
 #include "./Game.h"
 #include "../Logger/Logger.h"
 #include <sol/sol.hpp>
@@ -24,6 +25,182 @@ LevelLoader::~LevelLoader() {
     Logger::Log("Level Loader destructor called");
 };
 
+// Adds the components listed in a Lua components table to an entity or a prefab
+template <typename TTarget>
+void LevelLoader::LoadComponents(TTarget& target, sol::table components, const std::string& name) {
+    // Transform
+    sol::optional<sol::table> transform = components["transform"];
+    if (transform != sol::nullopt) {
+        target.template AddComponent<TransformComponent>(
+            glm::vec2(
+                components["transform"]["position"]["x"],
+                components["transform"]["position"]["y"]
+            ),
+            glm::vec2(
+                components["transform"]["scale"]["x"].get_or(1.0),
+                components["transform"]["scale"]["y"].get_or(1.0)
+            ),
+            components["transform"]["rotation"].get_or(0.0)
+        );
+        /* ex:
+        chopper.AddComponent<TransformComponent>(glm::vec2(500.0, 250.0), glm::vec2(2.0, 2.0), 0.0);
+        */
+    }
+
+    // RigidBody
+    sol::optional<sol::table> rigidbody = components["rigidbody"];
+    if (rigidbody != sol::nullopt) {
+        target.template AddComponent<RigidBodyComponent>(
+            glm::vec2(
+                components["rigidbody"]["velocity"]["x"].get_or(0.0),
+                components["rigidbody"]["velocity"]["y"].get_or(0.0)
+            )
+        );
+        /* ex:
+        chopper.AddComponent<RigidBodyComponent>(glm::vec2(0.0, 0.0));
+        */
+    }
+
+    // Sprite
+    sol::optional<sol::table> sprite = components["sprite"];
+    if (sprite != sol::nullopt) {
+        target.template AddComponent<SpriteComponent>(
+            components["sprite"]["texture_asset_id"],
+            components["sprite"]["width"],
+            components["sprite"]["height"],
+            components["sprite"]["src_rect_x"].get_or(0),
+            components["sprite"]["src_rect_y"].get_or(0),
+            components["sprite"]["z_index"].get_or(1),
+            components["sprite"]["fixed"].get_or(false)
+        );
+        /*
+        chopper.AddComponent<SpriteComponent>("chopper-image", 32, 32, 0, 0, 2, false);
+        */
+    }
+
+    // Animation
+    sol::optional<sol::table> animation = components["animation"];
+    if (animation != sol::nullopt) {
+        target.template AddComponent<AnimationComponent>(
+            components["animation"]["num_frames"].get_or(1),
+            components["animation"]["speed_rate"].get_or(1),
+            components["animation"]["should_loop"].get_or(true)
+        );
+        /* ex:
+        chopper.AddComponent<AnimationComponent>(2, 15, true);
+        */
+    }
+
+    // BoxCollider
+    sol::optional<sol::table> collider = components["boxcollider"];
+    if (collider != sol::nullopt) {
+        target.template AddComponent<BoxColliderComponent>(
+            components["boxcollider"]["width"],
+            components["boxcollider"]["height"],
+            glm::vec2(
+                components["boxcollider"]["offset"]["x"].get_or(0),
+                components["boxcollider"]["offset"]["y"].get_or(0)
+            )
+        );
+        /* ex:
+        chopper.AddComponent<BoxColliderComponent>(32, 32);
+        */
+    }
+    
+    // Health
+    sol::optional<sol::table> health = components["health"];
+    if (health != sol::nullopt) {
+        target.template AddComponent<HealthComponent>(
+            static_cast<int>(components["health"]["health_percentage"].get_or(100))
+        );
+        /* ex:
+        chopper.AddComponent<HealthComponent>(100);
+        */
+    }
+    
+    // ProjectileEmitter
+    sol::optional<sol::table> projectileEmitter = components["projectile_emitter"];
+    if (projectileEmitter != sol::nullopt) {
+        target.template AddComponent<ProjectileEmitterComponent>(
+            glm::vec2(
+                components["projectile_emitter"]["projectile_velocity"]["x"],
+                components["projectile_emitter"]["projectile_velocity"]["y"]
+            ),
+            static_cast<int>(components["projectile_emitter"]["repeat_frequency"].get_or(1)) * 1000,
+            static_cast<int>(components["projectile_emitter"]["projectile_duration"].get_or(10)) * 1000,
+            static_cast<int>(components["projectile_emitter"]["hit_percentage_damage"].get_or(10)),
+            components["projectile_emitter"]["friendly"].get_or(false)
+        );
+        /* ex:
+        chopper.AddComponent<ProjectileEmitterComponent>(glm::vec2(500.0, 500.0), 300, 5000, 10, true);
+        */
+    }
+
+    // CameraFollow
+    sol::optional<sol::table> cameraFollow = components["camera_follow"];
+    if (cameraFollow != sol::nullopt) {
+        target.template AddComponent<CameraFollowComponent>();
+    }
+
+    // KeyboardControlled
+    sol::optional<sol::table> keyboardControlled = components["keyboard_controller"];
+    if (keyboardControlled != sol::nullopt) {
+        target.template AddComponent<KeyboardControlledComponent>(
+            glm::vec2(
+                components["keyboard_controller"]["up_velocity"]["x"],
+                components["keyboard_controller"]["up_velocity"]["y"]
+            ),
+            glm::vec2(
+                components["keyboard_controller"]["right_velocity"]["x"],
+                components["keyboard_controller"]["right_velocity"]["y"]
+            ),
+            glm::vec2(
+                components["keyboard_controller"]["down_velocity"]["x"],
+                components["keyboard_controller"]["down_velocity"]["y"]
+            ),
+            glm::vec2(
+                components["keyboard_controller"]["left_velocity"]["x"],
+                components["keyboard_controller"]["left_velocity"]["y"]
+            )
+        );
+        /* ex:
+        chopper.AddComponent<KeyboardControlledComponent>(glm::vec2(0.0, -120.0), glm::vec2(120.0, 00.0), glm::vec2(00.0, 120.0), glm::vec2(-120.0, 00.0));
+        */
+    }
+
+    // LuaScriptComponent
+    sol::optional<sol::table> script = components["on_update_script"];
+    if (script != sol::nullopt) {
+        // Fetch the lua script function
+        sol::function func = components["on_update_script"][0];
+        // Add the sol func to the component
+        target.template AddComponent<LuaScriptComponent>(func, name);
+    }
+}
+
+sol::function LevelLoader::FindScript(sol::state& lua, const std::string& name) {
+    sol::optional<sol::table> level = lua["Level"];
+    const auto separator = name.find('.');
+    if (level == sol::nullopt || separator == std::string::npos) {
+        return sol::lua_nil;
+    }
+
+    // The entities are indexed by number, the prefabs by name
+    const std::string list = name.substr(0, separator);
+    const std::string key = name.substr(separator + 1);
+    sol::optional<sol::function> script;
+    if (list == "entities") {
+        script = level.value()[list][std::stoi(key)]["components"]["on_update_script"][0];
+    } else {
+        script = level.value()[list][key]["components"]["on_update_script"][0];
+    }
+    if (script == sol::nullopt) {
+        Logger::Error("Script " + name + " not found in the level");
+        return sol::lua_nil;
+    }
+    return script.value();
+}
+
 void LevelLoader::LoadLevel(sol::state& m_lua, const std::unique_ptr<Registry>& m_registry, const std::unique_ptr<AssetStore>& m_assetStore, SDL_Renderer* m_ptrRenderer, int level) {
 
     sol::load_result script = m_lua.load_file("assets/scripts/Level" + std::to_string(level) + ".lua");
@@ -85,7 +262,12 @@ void LevelLoader::LoadLevel(sol::state& m_lua, const std::unique_ptr<Registry>&
     int tileSize = map["tile_size"];
     double mapScale = map["scale"];
 
-    // Opening the tilemap
+    // Opening the tilemap, the components of every tile are read first and then added in bulk
+    std::vector<TransformComponent> tileTransforms;
+    std::vector<SpriteComponent> tileSprites;
+    tileTransforms.reserve(mapNumRows * mapNumCols);
+    tileSprites.reserve(mapNumRows * mapNumCols);
+
     std::fstream mapFile;
     mapFile.open(mapFilePath);
     for (int y = 0; y < mapNumRows; y++) {
@@ -97,16 +279,42 @@ void LevelLoader::LoadLevel(sol::state& m_lua, const std::unique_ptr<Registry>&
             int srcRectX = std::atoi(&ch) * tileSize;
             mapFile.ignore();
 
-            Entity tile = m_registry->CreateEntity();
-            tile.Group("tiles");
-            tile.AddComponent<TransformComponent>(glm::vec2(x * (mapScale * tileSize), y * (mapScale * tileSize)), glm::vec2(mapScale, mapScale), 0.0);
-            tile.AddComponent<SpriteComponent>(mapTextureAssetId, tileSize, tileSize, srcRectX, srcRectY, 0, false);
+            tileTransforms.emplace_back(glm::vec2(x * (mapScale * tileSize), y * (mapScale * tileSize)), glm::vec2(mapScale, mapScale), 0.0);
+            tileSprites.emplace_back(mapTextureAssetId, tileSize, tileSize, srcRectX, srcRectY, 0, false);
         }
     }
     mapFile.close();
+
+    const auto tiles = m_registry->CreateEntities(mapNumRows * mapNumCols);
+    m_registry->AddComponents<TransformComponent>(tiles, std::move(tileTransforms));
+    m_registry->AddComponents<SpriteComponent>(tiles, std::move(tileSprites));
+    m_registry->GroupEntities(tiles, Registry::GetGroupId("tiles"));
     Game::m_mapWidth = mapNumCols * tileSize * mapScale;
     Game::m_mapHeight = mapNumRows * tileSize * mapScale;
 
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    // Read the level prefabs, the entities that share the same components are declared once
+    // ex: prefabs = { obstacle = { group = "obstacles", components = { sprite = {...} } } }
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    sol::optional<sol::table> hasPrefabs = tlevel["prefabs"];
+    if (hasPrefabs != sol::nullopt) {
+        sol::table prefabs = tlevel["prefabs"];
+        for (auto& entry: prefabs) {
+            const std::string name = entry.first.as<std::string>();
+            sol::table prefabTable = entry.second.as<sol::table>();
+            Prefab& prefab = m_registry->AddPrefab(name);
+
+            sol::optional<std::string> group = prefabTable["group"];
+            if (group != sol::nullopt) {
+                prefab.Group(group.value());
+            }
+            sol::optional<sol::table> hasComponents = prefabTable["components"];
+            if (hasComponents != sol::nullopt) {
+                LoadComponents(prefab, prefabTable["components"], "prefabs." + name);
+            }
+        }
+    }
+
     //////////////////////////////////////////////////////////////////////////////////////////////
     // Read the level entities and components
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -121,171 +329,46 @@ void LevelLoader::LoadLevel(sol::state& m_lua, const std::unique_ptr<Registry>&
 
         sol::table entity = entities[i];
 
-        Entity newEntity = m_registry->CreateEntity();
+        // Prefab, the entity starts as a copy of it and its own components replace the prefab ones
+        const Prefab* prefab = nullptr;
+        sol::optional<std::string> prefabName = entity["prefab"];
+        if (prefabName != sol::nullopt) {
+            prefab = m_registry->GetPrefab(prefabName.value());
+            if (!prefab) {
+                Logger::Error("Unknown prefab " + prefabName.value() + " in level " + std::to_string(level));
+            }
+        }
+        Entity newEntity = prefab ? m_registry->Instantiate(*prefab).front() : m_registry->CreateEntity();
 
         // Tag
         sol::optional<std::string> tag = entity["tag"];
         if (tag != sol::nullopt) {
-            newEntity.Tag(entity["tag"]);
+            newEntity.Tag(tag.value());
         }
 
         // Group
         sol::optional<std::string> group = entity["group"];
         if (group != sol::nullopt) {
-            newEntity.Group(entity["group"]);
+            newEntity.Group(group.value());
         }
 
         // Components
         sol::optional<sol::table> hasComponents = entity["components"];
         // if has component in script
         if (hasComponents != sol::nullopt) {
-            // Transform
-            sol::optional<sol::table> transform = entity["components"]["transform"];
-            if (transform != sol::nullopt) {
-                newEntity.AddComponent<TransformComponent>(
-                    glm::vec2(
-                        entity["components"]["transform"]["position"]["x"],
-                        entity["components"]["transform"]["position"]["y"]
-                    ),
-                    glm::vec2(
-                        entity["components"]["transform"]["scale"]["x"].get_or(1.0),
-                        entity["components"]["transform"]["scale"]["y"].get_or(1.0)
-                    ),
-                    entity["components"]["transform"]["rotation"].get_or(0.0)
-                );
-                /* ex:
-                chopper.AddComponent<TransformComponent>(glm::vec2(500.0, 250.0), glm::vec2(2.0, 2.0), 0.0);
-                */
-            }
-
-            // RigidBody
-            sol::optional<sol::table> rigidbody = entity["components"]["rigidbody"];
-            if (rigidbody != sol::nullopt) {
-                newEntity.AddComponent<RigidBodyComponent>(
-                    glm::vec2(
-                        entity["components"]["rigidbody"]["velocity"]["x"].get_or(0.0),
-                        entity["components"]["rigidbody"]["velocity"]["y"].get_or(0.0)
-                    )
-                );
-                /* ex:
-                chopper.AddComponent<RigidBodyComponent>(glm::vec2(0.0, 0.0));
-                */
-            }
-
-            // Sprite
-            sol::optional<sol::table> sprite = entity["components"]["sprite"];
-            if (sprite != sol::nullopt) {
-                newEntity.AddComponent<SpriteComponent>(
-                    entity["components"]["sprite"]["texture_asset_id"],
-                    entity["components"]["sprite"]["width"],
-                    entity["components"]["sprite"]["height"],
-                    entity["components"]["sprite"]["src_rect_x"].get_or(0),
-                    entity["components"]["sprite"]["src_rect_y"].get_or(0),
-                    entity["components"]["sprite"]["z_index"].get_or(1),
-                    entity["components"]["sprite"]["fixed"].get_or(false)
-                );
-                /*
-                chopper.AddComponent<SpriteComponent>("chopper-image", 32, 32, 0, 0, 2, false);
-                */
-            }
-
-            // Animation
-            sol::optional<sol::table> animation = entity["components"]["animation"];
-            if (animation != sol::nullopt) {
-                newEntity.AddComponent<AnimationComponent>(
-                    entity["components"]["animation"]["num_frames"].get_or(1),
-                    entity["components"]["animation"]["speed_rate"].get_or(1),
-                    entity["components"]["animation"]["should_loop"].get_or(true)
-                );
-                /* ex:
-                chopper.AddComponent<AnimationComponent>(2, 15, true);
-                */
-            }
-
-            // BoxCollider
-            sol::optional<sol::table> collider = entity["components"]["boxcollider"];
-            if (collider != sol::nullopt) {
-                newEntity.AddComponent<BoxColliderComponent>(
-                    entity["components"]["boxcollider"]["width"],
-                    entity["components"]["boxcollider"]["height"],
-                    glm::vec2(
-                        entity["components"]["boxcollider"]["offset"]["x"].get_or(0),
-                        entity["components"]["boxcollider"]["offset"]["y"].get_or(0)
-                    )
-                );
-                /* ex:
-                chopper.AddComponent<BoxColliderComponent>(32, 32);
-                */
-            }
-            
-            // Health
-            sol::optional<sol::table> health = entity["components"]["health"];
-            if (health != sol::nullopt) {
-                newEntity.AddComponent<HealthComponent>(
-                    static_cast<int>(entity["components"]["health"]["health_percentage"].get_or(100))
-                );
-                /* ex:
-                chopper.AddComponent<HealthComponent>(100);
-                */
-            }
-            
-            // ProjectileEmitter
-            sol::optional<sol::table> projectileEmitter = entity["components"]["projectile_emitter"];
-            if (projectileEmitter != sol::nullopt) {
-                newEntity.AddComponent<ProjectileEmitterComponent>(
-                    glm::vec2(
-                        entity["components"]["projectile_emitter"]["projectile_velocity"]["x"],
-                        entity["components"]["projectile_emitter"]["projectile_velocity"]["y"]
-                    ),
-                    static_cast<int>(entity["components"]["projectile_emitter"]["repeat_frequency"].get_or(1)) * 1000,
-                    static_cast<int>(entity["components"]["projectile_emitter"]["projectile_duration"].get_or(10)) * 1000,
-                    static_cast<int>(entity["components"]["projectile_emitter"]["hit_percentage_damage"].get_or(10)),
-                    entity["components"]["projectile_emitter"]["friendly"].get_or(false)
-                );
-                /* ex:
-                chopper.AddComponent<ProjectileEmitterComponent>(glm::vec2(500.0, 500.0), 300, 5000, 10, true);
-                */
-            }
-
-            // CameraFollow
-            sol::optional<sol::table> cameraFollow = entity["components"]["camera_follow"];
-            if (cameraFollow != sol::nullopt) {
-                newEntity.AddComponent<CameraFollowComponent>();
-            }
-
-            // KeyboardControlled
-            sol::optional<sol::table> keyboardControlled = entity["components"]["keyboard_controller"];
-            if (keyboardControlled != sol::nullopt) {
-                newEntity.AddComponent<KeyboardControlledComponent>(
-                    glm::vec2(
-                        entity["components"]["keyboard_controller"]["up_velocity"]["x"],
-                        entity["components"]["keyboard_controller"]["up_velocity"]["y"]
-                    ),
-                    glm::vec2(
-                        entity["components"]["keyboard_controller"]["right_velocity"]["x"],
-                        entity["components"]["keyboard_controller"]["right_velocity"]["y"]
-                    ),
-                    glm::vec2(
-                        entity["components"]["keyboard_controller"]["down_velocity"]["x"],
-                        entity["components"]["keyboard_controller"]["down_velocity"]["y"]
-                    ),
-                    glm::vec2(
-                        entity["components"]["keyboard_controller"]["left_velocity"]["x"],
-                        entity["components"]["keyboard_controller"]["left_velocity"]["y"]
-                    )
-                );
-                /* ex:
-                chopper.AddComponent<KeyboardControlledComponent>(glm::vec2(0.0, -120.0), glm::vec2(120.0, 00.0), glm::vec2(00.0, 120.0), glm::vec2(-120.0, 00.0));
-                */
-            }
+            LoadComponents(newEntity, entity["components"], "entities." + std::to_string(i));
+        }
 
-            // LuaScriptComponent
-            sol::optional<sol::table> script = entity["components"]["on_update_script"];
-            if (script != sol::nullopt) {
-                // Fetch the lua script function
-                sol::function func = entity["components"]["on_update_script"][0];
-                // Add the sol func to the component
-                newEntity.AddComponent<LuaScriptComponent>(func);
+        // Parent, the tag of an entity declared before this one. The transform of the entity is
+        // then relative to its parent (ex: a turret on a tank)
+        sol::optional<std::string> parentTag = entity["parent"];
+        if (parentTag != sol::nullopt) {
+            try {
+                Entity parent = m_registry->GetEntityByTag(parentTag.value());
+                const auto local = newEntity.HasComponent<TransformComponent>() ? newEntity.GetComponent<const TransformComponent>() : TransformComponent();
+                m_registry->GetSystem<HierarchySystem>().SetParent(newEntity, parent, local.position, local.scale, local.rotation);
+            } catch (const std::out_of_range&) {
+                Logger::Error("Unknown parent " + parentTag.value() + " in level " + std::to_string(level));
             }
         }
         i++;
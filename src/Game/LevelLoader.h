@@ -14,6 +14,15 @@ class LevelLoader {
         ~LevelLoader();
 
         void LoadLevel(sol::state& m_lua, const std::unique_ptr<Registry>& m_registry, const std::unique_ptr<AssetStore>& m_assetStore, SDL_Renderer* m_ptrRenderer, int level);
+
+        // Script of an entity or prefab of the last level executed in lua, from the name the
+        // LevelLoader gave to its LuaScriptComponent (ex: "entities.12" or "prefabs.obstacle").
+        // Used to give the scripts back to the entities loaded from a Snapshot.
+        static sol::function FindScript(sol::state& lua, const std::string& name);
+
+    private:
+        // TTarget is an Entity or a Prefab, name is the one given to its script
+        template <typename TTarget> void LoadComponents(TTarget& target, sol::table components, const std::string& name);
 };
 
 #endif
\ No newline at end of file
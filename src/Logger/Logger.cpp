@@ -5,6 +5,7 @@
 #include <string>
 
 std::vector<LogEntry> Logger::messages;
+std::mutex Logger::m_mutex;
 
 std::string Logger::CurrentDateTimeToString() {
     std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
@@ -14,6 +15,9 @@ std::string Logger::CurrentDateTimeToString() {
 }
 
 void Logger::Log(const std::string& message) {
+    // Also guards std::localtime in CurrentDateTimeToString
+    std::lock_guard<std::mutex> lock(m_mutex);
+
     LogEntry logEntry;
     logEntry.type = LOG_INFO;
 
@@ -24,6 +28,9 @@ void Logger::Log(const std::string& message) {
 };
 
 void Logger::Error(const std::string& message) {
+    // Also guards std::localtime in CurrentDateTimeToString
+    std::lock_guard<std::mutex> lock(m_mutex);
+
     LogEntry logEntry;
     logEntry.type = LOG_ERROR;
 
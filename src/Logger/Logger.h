@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <mutex>
 
 enum LogType {
     LOG_INFO,
@@ -18,6 +19,8 @@ struct LogEntry {
 class Logger {
     private:
         static std::string CurrentDateTimeToString();
+        // Systems may log from worker threads
+        static std::mutex m_mutex;
     public:
         static std::vector<LogEntry> messages;
         static void Log(const std::string& message);
@@ -1,13 +1,60 @@
 #include <iostream>
+#include <cstdlib>
+#include <string>
 #include "./Game/Game.h"
 #include "./MapEditor/MapEditor.h"
+#include "./Logger/Logger.h"
 
+// Without arguments the map editor runs. The game runs with any of:
+//   --game                 play the game
+//   --record <file>        play the game and write its input events to the file (see EventLog)
+//   --replay <file>        play the input events of a recording instead of the keyboard
+//   --headless             with --replay, no window and no rendering, as fast as possible
+//   --fixed-dt <seconds>   same delta time for every frame (ex: 0.016), kept by --record
 int main(int argc, char* argv[]) {
 
-    //Game game;
-    //game.Initialize();
-    //game.Run();
-    //game.Destroy();
+    bool isGame = false;
+    GameOptions options;
+    for (int i = 1; i < argc; i++) {
+        const std::string argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+        isGame = true;
+
+        if (argument == "--game") {
+            continue;
+        } else if (argument == "--record" && hasValue) {
+            options.recordPath = argv[++i];
+        } else if (argument == "--replay" && hasValue) {
+            options.replayPath = argv[++i];
+        } else if (argument == "--headless") {
+            options.isHeadless = true;
+        } else if (argument == "--fixed-dt" && hasValue) {
+            options.fixedDeltaTime = std::atof(argv[++i]);
+        } else {
+            Logger::Error("Unknown argument " + argument);
+            return 1;
+        }
+    }
+    if (!options.recordPath.empty() && !options.replayPath.empty()) {
+        Logger::Error("--record and --replay can not be used together");
+        return 1;
+    }
+    if (options.isHeadless && options.replayPath.empty()) {
+        Logger::Error("--headless needs a --replay, nobody can play without a window");
+        return 1;
+    }
+
+    if (isGame) {
+        Game game(options);
+        if (!game.Initialize()) {
+            game.Destroy();
+            return 1;
+        }
+        game.Run();
+        game.Destroy();
+        return 0;
+    }
+
     MapEditor mapEditor;
     mapEditor.Initialize();
     mapEditor.Run();
@@ -0,0 +1,72 @@
+#include "FrameArena.h"
+#include "../Logger/Logger.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+FrameArena::FrameArena(size_t capacity): m_buffer(new char[capacity]), m_capacity(capacity), m_offset(0) {
+    m_lastFrameStats.capacity = capacity;
+}
+
+FrameArena::~FrameArena() {
+    FreeOverflowBlocks();
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment) {
+    const uintptr_t buffer = reinterpret_cast<uintptr_t>(m_buffer.get());
+
+    // Several threads can bump the offset at once, the one that loses the exchange aligns again
+    size_t offset = m_offset.load(std::memory_order_relaxed);
+    while (true) {
+        const size_t alignedOffset = ((buffer + offset + alignment - 1) & ~(alignment - 1)) - buffer;
+        if (alignedOffset > m_capacity || size > m_capacity - alignedOffset) {
+            return AllocateOverflow(size, alignment);
+        }
+        if (m_offset.compare_exchange_weak(offset, alignedOffset + size, std::memory_order_relaxed)) {
+            return m_buffer.get() + alignedOffset;
+        }
+    }
+}
+
+void* FrameArena::AllocateOverflow(size_t size, size_t alignment) {
+    void* data = ::operator new(size, std::align_val_t(alignment));
+
+    std::lock_guard<std::mutex> lock(m_overflowMutex);
+    m_overflowBlocks.push_back({ data, alignment });
+    m_overflowBytes += size;
+    return data;
+}
+
+void FrameArena::FreeOverflowBlocks() {
+    for (const auto& block: m_overflowBlocks) {
+        ::operator delete(block.data, std::align_val_t(block.alignment));
+    }
+    m_overflowBlocks.clear();
+    m_overflowBytes = 0;
+}
+
+void FrameArena::Reset() {
+    auto& stats = m_lastFrameStats;
+    stats.frameBytes = m_offset.load(std::memory_order_relaxed) + m_overflowBytes;
+    stats.peakBytes = std::max(stats.peakBytes, stats.frameBytes);
+    stats.numOverflows = static_cast<int>(m_overflowBlocks.size());
+
+    // Make room for a frame like this one, with some margin, so the next ones stay off the heap
+    if (!m_overflowBlocks.empty()) {
+        m_capacity = std::max(m_capacity * 2, stats.frameBytes + stats.frameBytes / 2);
+        m_buffer.reset(new char[m_capacity]);
+        Logger::Log("Frame arena grown to " + std::to_string(m_capacity) + " bytes");
+    }
+    stats.capacity = m_capacity;
+
+    FreeOverflowBlocks();
+    m_offset.store(0, std::memory_order_relaxed);
+}
+
+size_t FrameArena::GetUsedBytes() const {
+    return m_offset.load(std::memory_order_relaxed);
+}
+
+const FrameArenaStats& FrameArena::GetLastFrameStats() const {
+    return m_lastFrameStats;
+}
@@ -0,0 +1,101 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////
+// FrameArena
+////////////////////////////////////////////////////////////////////////////////////
+//// Memory for the data a system only needs during the current frame (visible sprites,
+//// scratch arrays...). Allocating bumps an offset in one buffer, freeing does nothing,
+//// and everything is released at once by Reset() at the end of the frame (Game::Render).
+//// Allocate() can be called from the worker threads of the scheduler at the same time.
+//// When a frame needs more than the buffer, the extra allocations come from the heap and
+//// the buffer grows at the next Reset(), so the following frames fit in it again.
+////////////////////////////////////////////////////////////////////////////////////
+
+struct FrameArenaStats {
+    // Bytes allocated during the last frame, overflow included
+    size_t frameBytes = 0;
+    // Most bytes allocated in one frame since the start
+    size_t peakBytes = 0;
+    // Size of the buffer, after the growth of the last Reset()
+    size_t capacity = 0;
+    // Allocations of the last frame that did not fit in the buffer
+    int numOverflows = 0;
+};
+
+class FrameArena {
+    private:
+        struct OverflowBlock {
+            void* data;
+            size_t alignment;
+        };
+
+        std::unique_ptr<char[]> m_buffer;
+        size_t m_capacity;
+        std::atomic<size_t> m_offset;
+
+        std::mutex m_overflowMutex;
+        std::vector<OverflowBlock> m_overflowBlocks;
+        size_t m_overflowBytes = 0;
+
+        FrameArenaStats m_lastFrameStats;
+
+        void* AllocateOverflow(size_t size, size_t alignment);
+        void FreeOverflowBlocks();
+
+    public:
+        FrameArena(size_t capacity);
+        ~FrameArena();
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator =(const FrameArena&) = delete;
+
+        // The memory stays valid until the next Reset(), alignment must be a power of 2
+        void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+        // Releases every allocation of the frame, nothing may be using them nor allocating
+        void Reset();
+
+        // Bytes allocated in the buffer since the last Reset()
+        size_t GetUsedBytes() const;
+        const FrameArenaStats& GetLastFrameStats() const;
+};
+
+// STL allocator taking its memory from a FrameArena, for containers living one frame only
+// ex: FrameVector<Entity> visible(FrameAllocator<Entity>(frameArena));
+template <typename T>
+class FrameAllocator {
+    private:
+        template <typename U> friend class FrameAllocator;
+        FrameArena* m_arena;
+
+    public:
+        typedef T value_type;
+
+        FrameAllocator(FrameArena& arena) noexcept: m_arena(&arena) {}
+        template <typename U> FrameAllocator(const FrameAllocator<U>& other) noexcept: m_arena(other.m_arena) {}
+
+        T* allocate(size_t count) {
+            if (count > static_cast<size_t>(-1) / sizeof(T)) {
+                throw std::bad_alloc();
+            }
+            return static_cast<T*>(m_arena->Allocate(count * sizeof(T), alignof(T)));
+        }
+
+        // Released with the rest of the frame by FrameArena::Reset()
+        void deallocate(T*, size_t) noexcept {}
+
+        template <typename U> bool operator ==(const FrameAllocator<U>& other) const { return m_arena == other.m_arena; }
+        template <typename U> bool operator !=(const FrameAllocator<U>& other) const { return m_arena != other.m_arena; }
+};
+
+template <typename T> using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+#endif
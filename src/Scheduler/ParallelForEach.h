@@ -0,0 +1,54 @@
+#ifndef PARALLELFOREACH_H
+#define PARALLELFOREACH_H
+
+#include "../ECS/ECS.h"
+#include "./WorkerPool.h"
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////
+// ParallelForEach
+////////////////////////////////////////////////////////////////////////////////////
+//// Split the loop over the entities of a system or of a view between the threads of a
+//// WorkerPool. The callback runs on several threads at the same time: it may change the
+//// components of its own entity, read anything nobody writes, and Kill() entities, but
+//// it must not create entities or add/remove components.
+////////////////////////////////////////////////////////////////////////////////////
+
+// Number of system entities handed to one job
+const int PARALLEL_FOR_EACH_GRAIN_SIZE = 256;
+
+// Calls func(Entity) for every entity, ex: ParallelForEach(workerPool, GetSystemEntities(), [](Entity entity) {...});
+template <typename TFunc>
+void ParallelForEach(WorkerPool& workerPool, const std::vector<Entity>& entities, TFunc func) {
+    workerPool.ParallelFor(static_cast<int>(entities.size()), PARALLEL_FOR_EACH_GRAIN_SIZE, [&entities, &func](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            func(entities[i]);
+        }
+    });
+}
+
+// Calls func(Entity, TComponents&...) for every entity of the view, one job per view block
+// ex: ParallelForEach(workerPool, registry->View<TransformComponent>(), [](Entity entity, TransformComponent& transform) {...});
+template <typename ...TComponents, typename TFunc>
+void ParallelForEach(WorkerPool& workerPool, const ComponentView<TComponents...>& view, TFunc func) {
+    workerPool.ParallelFor(view.GetNumBlocks(), 1, [&view, &func](int begin, int end) {
+        for (int block = begin; block < end; block++) {
+            view.EachInBlock(block, func);
+        }
+    });
+}
+
+#ifndef ECS_ARCHETYPE_STORAGE
+// Same for an owning group, ex: ParallelForEach(workerPool, registry->GetOwningGroup<TransformComponent, SpriteComponent>(), ...);
+// (with ECS_ARCHETYPE_STORAGE an OwningGroup is a ComponentView, handled above)
+template <typename ...TComponents, typename TFunc>
+void ParallelForEach(WorkerPool& workerPool, const OwningGroup<TComponents...>& group, TFunc func) {
+    workerPool.ParallelFor(group.GetNumBlocks(), 1, [&group, &func](int begin, int end) {
+        for (int block = begin; block < end; block++) {
+            group.EachInBlock(block, func);
+        }
+    });
+}
+#endif
+
+#endif
@@ -0,0 +1,134 @@
+#include "SystemScheduler.h"
+#include "../Logger/Logger.h"
+#include <algorithm>
+
+SystemScheduler::SystemScheduler(int numThreads): m_numRunning(0) {
+    if (numThreads <= 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    m_workerPool = std::make_unique<WorkerPool>(numThreads - 1);
+    Logger::Log("System scheduler running on " + std::to_string(numThreads) + " thread(s)");
+}
+
+bool SystemScheduler::Conflicts(const System& a, const System& b) {
+    if (a.IsExclusive() || b.IsExclusive()) {
+        return true;
+    }
+    const auto& aWrites = a.GetWriteSignature();
+    const auto& bWrites = b.GetWriteSignature();
+    return (aWrites & (b.GetReadSignature() | bWrites)).any() || (bWrites & a.GetReadSignature()).any();
+}
+
+void SystemScheduler::AddSystem(const std::string& name, const System& system, std::function<void()> update) {
+    auto scheduledSystem = std::make_unique<ScheduledSystem>();
+    scheduledSystem->name = name;
+    scheduledSystem->system = &system;
+    scheduledSystem->update = std::move(update);
+
+    // Keep the serial order between conflicting systems
+    const int index = static_cast<int>(m_systems.size());
+    for (int i = 0; i < index; i++) {
+        if (Conflicts(*m_systems[i]->system, system)) {
+            scheduledSystem->dependencies.push_back(i);
+            m_systems[i]->dependents.push_back(index);
+        }
+    }
+    m_systems.push_back(std::move(scheduledSystem));
+}
+
+void SystemScheduler::Run() {
+    const auto frameStart = std::chrono::steady_clock::now();
+
+    if (m_workerPool->GetNumWorkers() == 0) {
+        for (auto& scheduledSystem: m_systems) {
+            scheduledSystem->start = std::chrono::steady_clock::now();
+            scheduledSystem->update();
+            scheduledSystem->end = std::chrono::steady_clock::now();
+        }
+    }
+    else {
+        for (auto& scheduledSystem: m_systems) {
+            scheduledSystem->remainingDependencies = static_cast<int>(scheduledSystem->dependencies.size());
+        }
+
+        // Start the systems that wait for nobody, the others are started by their last dependency
+        for (int i = 0; i < static_cast<int>(m_systems.size()); i++) {
+            if (m_systems[i]->dependencies.empty()) {
+                m_workerPool->Submit([this, i]() { RunSystem(i); }, &m_numRunning);
+            }
+        }
+        m_workerPool->Wait(m_numRunning);
+    }
+
+    UpdateFrameStats(frameStart, std::chrono::steady_clock::now());
+}
+
+void SystemScheduler::RunSystem(int index) {
+    auto& scheduledSystem = *m_systems[index];
+    scheduledSystem.start = std::chrono::steady_clock::now();
+    scheduledSystem.update();
+    scheduledSystem.end = std::chrono::steady_clock::now();
+
+    for (auto dependent: scheduledSystem.dependents) {
+        if (--m_systems[dependent]->remainingDependencies == 0) {
+            m_workerPool->Submit([this, dependent]() { RunSystem(dependent); }, &m_numRunning);
+        }
+    }
+}
+
+void SystemScheduler::UpdateFrameStats(std::chrono::steady_clock::time_point frameStart, std::chrono::steady_clock::time_point frameEnd) {
+    typedef std::chrono::duration<double, std::milli> Milliseconds;
+    auto& stats = m_lastFrameStats;
+    const int numSystems = static_cast<int>(m_systems.size());
+
+    stats.frameMs = Milliseconds(frameEnd - frameStart).count();
+    stats.serialMs = 0;
+    stats.systems.resize(numSystems);
+
+    // Longest path ending at each system, dependencies always come earlier in m_systems
+    auto& pathMs = m_pathMs;
+    auto& pathPrevious = m_pathPrevious;
+    pathMs.assign(numSystems, 0);
+    pathPrevious.assign(numSystems, -1);
+    int criticalPathEnd = -1;
+
+    for (int i = 0; i < numSystems; i++) {
+        const auto& scheduledSystem = *m_systems[i];
+        auto& timing = stats.systems[i];
+        timing.name = scheduledSystem.name;
+        timing.startMs = Milliseconds(scheduledSystem.start - frameStart).count();
+        timing.durationMs = Milliseconds(scheduledSystem.end - scheduledSystem.start).count();
+        stats.serialMs += timing.durationMs;
+
+        for (auto dependency: scheduledSystem.dependencies) {
+            if (pathMs[dependency] > pathMs[i]) {
+                pathMs[i] = pathMs[dependency];
+                pathPrevious[i] = dependency;
+            }
+        }
+        pathMs[i] += timing.durationMs;
+
+        if (criticalPathEnd == -1 || pathMs[i] > pathMs[criticalPathEnd]) {
+            criticalPathEnd = i;
+        }
+    }
+
+    stats.criticalPathMs = criticalPathEnd == -1 ? 0 : pathMs[criticalPathEnd];
+    stats.criticalPath.clear();
+    for (int i = criticalPathEnd; i != -1; i = pathPrevious[i]) {
+        stats.criticalPath.push_back(i);
+    }
+    std::reverse(stats.criticalPath.begin(), stats.criticalPath.end());
+}
+
+int SystemScheduler::GetNumThreads() const {
+    return m_workerPool->GetNumWorkers() + 1;
+}
+
+WorkerPool& SystemScheduler::GetWorkerPool() {
+    return *m_workerPool;
+}
+
+const SchedulerFrameStats& SystemScheduler::GetLastFrameStats() const {
+    return m_lastFrameStats;
+}
@@ -0,0 +1,103 @@
+#ifndef SYSTEMSCHEDULER_H
+#define SYSTEMSCHEDULER_H
+
+#include "../ECS/ECS.h"
+#include "./WorkerPool.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <chrono>
+
+////////////////////////////////////////////////////////////////////////////////////
+// SystemScheduler
+////////////////////////////////////////////////////////////////////////////////////
+//// Runs the per frame system updates on a WorkerPool. Each system declares the
+//// components it reads and writes (System::ReadsComponent/WritesComponent), and the
+//// scheduler builds a dependency graph from them in the order the systems were added:
+//// a system waits for every earlier system it conflicts with, the others run at the
+//// same time. Exclusive systems wait for, and are waited by, every other system.
+////////////////////////////////////////////////////////////////////////////////////
+
+// Time spent by one system in the last frame, in milliseconds since the frame start
+struct SystemTiming {
+    std::string name;
+    double startMs = 0;
+    double durationMs = 0;
+};
+
+struct SchedulerFrameStats {
+    // Wall clock time of the whole frame
+    double frameMs = 0;
+    // Sum of the system times, what the frame would cost running serially
+    double serialMs = 0;
+    // Longest chain of dependent systems, the best frame time the graph allows
+    double criticalPathMs = 0;
+    // Indices in systems, first to last
+    std::vector<int> criticalPath;
+    std::vector<SystemTiming> systems;
+};
+
+class SystemScheduler {
+    private:
+        struct ScheduledSystem {
+            std::string name;
+            const System* system;
+            std::function<void()> update;
+
+            // Earlier systems this one waits for, and later systems waiting for this one
+            std::vector<int> dependencies;
+            std::vector<int> dependents;
+            std::atomic<int> remainingDependencies;
+
+            std::chrono::steady_clock::time_point start;
+            std::chrono::steady_clock::time_point end;
+        };
+
+        std::vector<std::unique_ptr<ScheduledSystem>> m_systems;
+        std::unique_ptr<WorkerPool> m_workerPool;
+
+        // Systems still queued or running in the current frame, Run() waits for all of them
+        std::atomic<int> m_numRunning;
+
+        SchedulerFrameStats m_lastFrameStats;
+
+        // Longest path ending at each system and the system before it on that path, kept between
+        // frames so computing the stats does not allocate
+        std::vector<double> m_pathMs;
+        std::vector<int> m_pathPrevious;
+
+        static bool Conflicts(const System& a, const System& b);
+        void RunSystem(int index);
+        void UpdateFrameStats(std::chrono::steady_clock::time_point frameStart, std::chrono::steady_clock::time_point frameEnd);
+
+    public:
+        // numThreads = 0 uses every hardware thread, 1 runs every system serially on the caller thread.
+        // The caller thread counts as one of them, it runs systems too while it waits in Run().
+        SystemScheduler(int numThreads = 0);
+        ~SystemScheduler() = default;
+
+        // Schedule the update of a system, the systems are added in the order they ran serially.
+        // ex: scheduler->AddSystem<MovementSystem>("Movement", registry, [&](MovementSystem& system) { system.Update(registry, deltaTime); });
+        template <typename TSystem, typename TFunc> void AddSystem(const std::string& name, const std::unique_ptr<Registry>& registry, TFunc update);
+        void AddSystem(const std::string& name, const System& system, std::function<void()> update);
+
+        // Run every scheduled system once and wait for all of them
+        void Run();
+
+        int GetNumThreads() const;
+
+        // Pool the systems run on, systems can use it to split their own loops (see ParallelForEach.h)
+        WorkerPool& GetWorkerPool();
+        const SchedulerFrameStats& GetLastFrameStats() const;
+};
+
+template <typename TSystem, typename TFunc>
+void SystemScheduler::AddSystem(const std::string& name, const std::unique_ptr<Registry>& registry, TFunc update) {
+    // The system is looked up once here instead of every frame
+    TSystem& system = registry->GetSystem<TSystem>();
+    AddSystem(name, system, [&system, update]() { update(system); });
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include "WorkerPool.h"
+
+// Pool and deque of the current thread, set on the pool's own worker threads
+static thread_local const WorkerPool* t_workerPool = nullptr;
+static thread_local int t_queueIndex = 0;
+
+WorkerPool::WorkerPool(int numWorkers): m_numQueuedJobs(0), m_isStopping(false) {
+    numWorkers = std::max(0, numWorkers);
+    for (int i = 0; i < numWorkers + 1; i++) {
+        m_queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    m_workers.reserve(numWorkers);
+    for (int i = 0; i < numWorkers; i++) {
+        m_workers.emplace_back(&WorkerPool::WorkerLoop, this, i + 1);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_isStopping = true;
+    }
+    m_jobAvailable.notify_all();
+    for (auto& worker: m_workers) {
+        worker.join();
+    }
+}
+
+int WorkerPool::GetNumWorkers() const {
+    return static_cast<int>(m_workers.size());
+}
+
+int WorkerPool::GetQueueIndex() const {
+    return t_workerPool == this ? t_queueIndex : 0;
+}
+
+void WorkerPool::Submit(std::function<void()> job, std::atomic<int>* counter) {
+    if (counter) {
+        counter->fetch_add(1);
+    }
+
+    auto& queue = *m_queues[GetQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.PushBack({ std::move(job), counter });
+    }
+    m_numQueuedJobs.fetch_add(1);
+
+    // Sleeping workers check m_numQueuedJobs holding this mutex, taking it here means none of
+    // them can miss the notification between its check and its wait
+    if (!m_workers.empty()) {
+        { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+        m_jobAvailable.notify_one();
+    }
+}
+
+bool WorkerPool::PopJob(int queueIndex, Job& job) {
+    // Newest job of our own deque first
+    {
+        auto& queue = *m_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.size > 0) {
+            queue.PopBack(job);
+            m_numQueuedJobs.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // Then steal the oldest job of the other deques, starting with our neighbour
+    const int numQueues = static_cast<int>(m_queues.size());
+    for (int i = 1; i < numQueues; i++) {
+        auto& queue = *m_queues[(queueIndex + i) % numQueues];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.size > 0) {
+            queue.PopFront(job);
+            m_numQueuedJobs.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkerPool::TryRunJob(int queueIndex) {
+    Job job;
+    if (!PopJob(queueIndex, job)) {
+        return false;
+    }
+    job.function();
+    if (job.counter) {
+        job.counter->fetch_sub(1);
+    }
+    return true;
+}
+
+void WorkerPool::Wait(const std::atomic<int>& counter) {
+    const int queueIndex = GetQueueIndex();
+    while (counter.load() > 0) {
+        // The last jobs may be running on other threads, let them finish
+        if (!TryRunJob(queueIndex)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void WorkerPool::WorkerLoop(int queueIndex) {
+    t_workerPool = this;
+    t_queueIndex = queueIndex;
+
+    while (true) {
+        if (TryRunJob(queueIndex)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_jobAvailable.wait(lock, [this]() { return m_isStopping || m_numQueuedJobs.load() > 0; });
+        if (m_isStopping && m_numQueuedJobs.load() == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////////////////////
+// WorkerPool
+////////////////////////////////////////////////////////////////////////////////////
+//// A fixed set of threads started once, with a work-stealing deque of jobs per thread.
+//// A thread pushes and pops jobs at the back of its own deque (newest first, still hot in
+//// cache), and when it runs out it steals the oldest job from the front of another deque.
+//// Threads outside the pool share one extra deque. Waiting for jobs never blocks: the
+//// waiting thread keeps running queued jobs, so jobs can submit and wait for other jobs.
+//// Jobs must not throw.
+////////////////////////////////////////////////////////////////////////////////////
+class WorkerPool {
+    private:
+        struct Job {
+            std::function<void()> function;
+            // Decremented when the job is done, see Wait()
+            std::atomic<int>* counter;
+        };
+
+        // Padded so the deques of two threads never share a cache line.
+        // The deque is a ring buffer that only grows, a steady frame queues jobs without allocating.
+        struct alignas(64) WorkQueue {
+            std::mutex mutex;
+            std::vector<Job> jobs;
+            size_t front = 0;
+            size_t size = 0;
+
+            void PushBack(Job&& job) {
+                if (size == jobs.size()) {
+                    // Unroll the ring in a bigger one
+                    std::vector<Job> grown(std::max<size_t>(16, jobs.size() * 2));
+                    for (size_t i = 0; i < size; i++) {
+                        grown[i] = std::move(jobs[(front + i) % jobs.size()]);
+                    }
+                    jobs.swap(grown);
+                    front = 0;
+                }
+                jobs[(front + size) % jobs.size()] = std::move(job);
+                size++;
+            }
+
+            void PopBack(Job& job) {
+                size--;
+                job = std::move(jobs[(front + size) % jobs.size()]);
+            }
+
+            void PopFront(Job& job) {
+                job = std::move(jobs[front]);
+                front = (front + 1) % jobs.size();
+                size--;
+            }
+        };
+
+        std::vector<std::thread> m_workers;
+
+        // [0] = threads outside the pool, [i + 1] = worker i
+        std::vector<std::unique_ptr<WorkQueue>> m_queues;
+
+        // Jobs queued in any deque, idle workers sleep while there are none
+        std::atomic<int> m_numQueuedJobs;
+        std::mutex m_sleepMutex;
+        std::condition_variable m_jobAvailable;
+        std::atomic<bool> m_isStopping;
+
+        int GetQueueIndex() const;
+        bool PopJob(int queueIndex, Job& job);
+        bool TryRunJob(int queueIndex);
+        void WorkerLoop(int queueIndex);
+
+    public:
+        // With 0 workers every job runs on the thread that waits for it
+        WorkerPool(int numWorkers);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator =(const WorkerPool&) = delete;
+
+        int GetNumWorkers() const;
+
+        // Queue a job on the deque of the calling thread, counter (optional) is incremented now
+        // and decremented when the job is done
+        void Submit(std::function<void()> job, std::atomic<int>* counter = nullptr);
+
+        // Run queued jobs on the calling thread until counter drops to 0
+        void Wait(const std::atomic<int>& counter);
+
+        // Calls func(begin, end) over [0, count) split in ranges of grainSize, on every thread of the
+        // pool and the calling thread, and returns when all of them are done.
+        template <typename TFunc> void ParallelFor(int count, int grainSize, TFunc func);
+};
+
+template <typename TFunc>
+void WorkerPool::ParallelFor(int count, int grainSize, TFunc func) {
+    grainSize = std::max(1, grainSize);
+    if (count <= grainSize || m_workers.empty()) {
+        if (count > 0) {
+            func(0, count);
+        }
+        return;
+    }
+
+    // Queue every range but the first, which the calling thread runs right away
+    std::atomic<int> counter(0);
+    for (int begin = grainSize; begin < count; begin += grainSize) {
+        const int end = std::min(begin + grainSize, count);
+        Submit([&func, begin, end]() { func(begin, end); }, &counter);
+    }
+    func(0, grainSize);
+    Wait(counter);
+}
+
+#endif
@@ -0,0 +1,537 @@
+#include "Snapshot.h"
+#include "../Components/AnimationComponent.h"
+#include "../Components/BoxColliderComponent.h"
+#include "../Components/CameraFollowComponent.h"
+#include "../Components/ChildrenComponent.h"
+#include "../Components/HealthComponent.h"
+#include "../Components/KeyboardControlledComponent.h"
+#include "../Components/LuaScriptComponent.h"
+#include "../Components/ParentComponent.h"
+#include "../Components/ProjectileComponent.h"
+#include "../Components/ProjectileEmitterComponent.h"
+#include "../Components/RigidBodyComponent.h"
+#include "../Components/SpriteComponent.h"
+#include "../Components/TextLabelComponent.h"
+#include "../Components/TransformComponent.h"
+#include "../Logger/Logger.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <tuple>
+#include <typeinfo>
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// Component serializers
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+template <>
+struct ComponentSerializer<SpriteComponent> {
+    static constexpr bool isRaw = false;
+
+    static void Write(SnapshotWriter& writer, const SpriteComponent& sprite) {
+        writer.Write(static_cast<int32_t>(sprite.width));
+        writer.Write(static_cast<int32_t>(sprite.height));
+        writer.WriteString(sprite.assetId);
+        writer.Write(sprite.srcRect);
+        writer.Write(static_cast<int32_t>(sprite.zIndex));
+        writer.Write(sprite.isFixed);
+        writer.Write(sprite.flip);
+    }
+
+    static void Read(SnapshotReader& reader, SpriteComponent& sprite, const ScriptResolver&) {
+        sprite.width = reader.Read<int32_t>();
+        sprite.height = reader.Read<int32_t>();
+        sprite.assetId = reader.ReadString();
+        sprite.srcRect = reader.Read<SDL_Rect>();
+        sprite.zIndex = reader.Read<int32_t>();
+        sprite.isFixed = reader.Read<bool>();
+        sprite.flip = reader.Read<SDL_RendererFlip>();
+    }
+};
+
+template <>
+struct ComponentSerializer<TextLabelComponent> {
+    static constexpr bool isRaw = false;
+
+    static void Write(SnapshotWriter& writer, const TextLabelComponent& textLabel) {
+        writer.Write(textLabel.position);
+        writer.WriteString(textLabel.text);
+        writer.WriteString(textLabel.assetId);
+        writer.Write(textLabel.color);
+        writer.Write(textLabel.isFixed);
+    }
+
+    static void Read(SnapshotReader& reader, TextLabelComponent& textLabel, const ScriptResolver&) {
+        textLabel.position = reader.Read<glm::vec2>();
+        textLabel.text = reader.ReadString();
+        textLabel.assetId = reader.ReadString();
+        textLabel.color = reader.Read<SDL_Color>();
+        textLabel.isFixed = reader.Read<bool>();
+    }
+};
+
+// Only the name of the script is written, the function is looked up again when loading
+template <>
+struct ComponentSerializer<LuaScriptComponent> {
+    static constexpr bool isRaw = false;
+
+    static void Write(SnapshotWriter& writer, const LuaScriptComponent& script) {
+        writer.WriteString(script.name);
+    }
+
+    static void Read(SnapshotReader& reader, LuaScriptComponent& script, const ScriptResolver& scriptResolver) {
+        script.name = reader.ReadString();
+        if (scriptResolver && !script.name.empty()) {
+            script.func = scriptResolver(script.name);
+        }
+    }
+};
+
+template <>
+struct ComponentSerializer<ParentComponent> {
+    static constexpr bool isRaw = false;
+
+    static void Write(SnapshotWriter& writer, const ParentComponent& link) {
+        writer.WriteEntity(link.parent);
+        writer.Write(link.localPosition);
+        writer.Write(link.localScale);
+        writer.Write(link.localRotation);
+    }
+
+    static void Read(SnapshotReader& reader, ParentComponent& link, const ScriptResolver&) {
+        link.parent = reader.ReadEntity();
+        link.localPosition = reader.Read<glm::vec2>();
+        link.localScale = reader.Read<glm::vec2>();
+        link.localRotation = reader.Read<double>();
+    }
+};
+
+template <>
+struct ComponentSerializer<ChildrenComponent> {
+    static constexpr bool isRaw = false;
+
+    static void Write(SnapshotWriter& writer, const ChildrenComponent& children) {
+        writer.Write(static_cast<uint32_t>(children.children.size()));
+        for (Entity child: children.children) {
+            writer.WriteEntity(child);
+        }
+    }
+
+    static void Read(SnapshotReader& reader, ChildrenComponent& children, const ScriptResolver&) {
+        const auto numChildren = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < numChildren && reader.IsValid(); i++) {
+            children.children.push_back(reader.ReadEntity());
+        }
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// Snapshot
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+    const char MAGIC[8] = { 'E', 'C', 'S', 'S', 'N', 'A', 'P', '\0' };
+
+    // Fixed size start of the blob, checked before the registry is touched
+    struct SnapshotHeader {
+        char magic[8];
+        uint32_t formatVersion;
+        uint32_t numComponentTypes;
+        uint64_t schemaHash;
+        uint64_t payloadSize;
+        uint64_t payloadChecksum;
+    };
+
+    // FNV-1a, enough to tell two schemas or a damaged file apart. The bytes are mixed 8 at a time,
+    // the checksum of a whole level costs about a millisecond.
+    uint64_t Hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+        for (; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    template <typename ...TComponents>
+    uint64_t HashComponentTypes(uint64_t hash, ComponentList<TComponents...>) {
+        auto hashType = [&hash](const char* name, uint64_t size, uint64_t alignment, bool isRaw) {
+            hash = Hash(name, std::strlen(name), hash);
+            hash = Hash(&size, sizeof(size), hash);
+            hash = Hash(&alignment, sizeof(alignment), hash);
+            hash = Hash(&isRaw, sizeof(isRaw), hash);
+        };
+        (hashType(typeid(TComponents).name(), sizeof(TComponents), alignof(TComponents), ComponentSerializer<TComponents>::isRaw), ...);
+        return hash;
+    }
+
+    // Reverse of the interned name maps, [vector index = tag or group id]
+    std::vector<std::string> GetNames(const std::unordered_map<std::string, int>& ids) {
+        std::vector<std::string> names(ids.size());
+        for (const auto& id: ids) {
+            if (id.second >= static_cast<int>(names.size())) {
+                names.resize(id.second + 1);
+            }
+            names[id.second] = id.first;
+        }
+        return names;
+    }
+
+    // The signatures are written as 64 bits words, as many as the manifest needs
+    const size_t SIGNATURE_WORDS = (MAX_COMPONENTS + 63) / 64;
+
+    void SignatureToWords(const Signature& signature, uint64_t* words) {
+        std::fill(words, words + SIGNATURE_WORDS, 0);
+        for (size_t componentId = 0; componentId < MAX_COMPONENTS; componentId++) {
+            if (signature.test(componentId)) {
+                words[componentId / 64] |= uint64_t(1) << (componentId % 64);
+            }
+        }
+    }
+
+    Signature WordsToSignature(const uint64_t* words) {
+        Signature signature;
+        for (size_t componentId = 0; componentId < MAX_COMPONENTS; componentId++) {
+            if (words[componentId / 64] & (uint64_t(1) << (componentId % 64))) {
+                signature.set(componentId);
+            }
+        }
+        return signature;
+    }
+
+    // Components of one type read from a blob, added to the registry once the whole blob is read
+    template <typename TComponent>
+    struct LoadedComponents {
+        std::vector<int32_t> entityIds;
+        std::vector<TComponent> components;
+    };
+
+    template <typename TList> struct LoadedComponentTypes;
+    template <typename ...TComponents>
+    struct LoadedComponentTypes<ComponentList<TComponents...>> {
+        typedef std::tuple<LoadedComponents<TComponents>...> type;
+    };
+
+    // Adds the component type to the signatures of its entities, to check them against the blob
+    template <typename TComponent>
+    bool ReadComponentType(SnapshotReader& reader, int numEntities, const ScriptResolver& scriptResolver, LoadedComponents<TComponent>& loaded, std::vector<Signature>& signatures) {
+        const auto numComponents = reader.Read<uint32_t>();
+        if (!reader.IsValid() || numComponents > static_cast<uint32_t>(numEntities)) {
+            Logger::Error("Snapshot has more components than entities");
+            return false;
+        }
+
+        loaded.entityIds.resize(numComponents);
+        reader.Read(loaded.entityIds.data(), numComponents * sizeof(int32_t));
+
+        // The trivially copyable components are copied all at once
+        loaded.components.resize(numComponents);
+        if constexpr (ComponentSerializer<TComponent>::isRaw) {
+            reader.Read(loaded.components.data(), numComponents * sizeof(TComponent));
+        } else {
+            for (auto& component: loaded.components) {
+                ComponentSerializer<TComponent>::Read(reader, component, scriptResolver);
+            }
+        }
+        if (!reader.IsValid()) {
+            return false;
+        }
+
+        const auto componentId = Component<TComponent>::GetId();
+        for (int32_t entityId: loaded.entityIds) {
+            if (entityId < 0 || entityId >= numEntities || signatures[entityId].test(componentId)) {
+                Logger::Error("Snapshot has a component for an unknown entity, or two for the same entity");
+                return false;
+            }
+            signatures[entityId].set(componentId);
+        }
+        return true;
+    }
+
+    template <typename ...TComponents>
+    bool ReadComponents(SnapshotReader& reader, int numEntities, const ScriptResolver& scriptResolver, std::tuple<LoadedComponents<TComponents>...>& loaded, std::vector<Signature>& signatures) {
+        return (ReadComponentType<TComponents>(reader, numEntities, scriptResolver, std::get<LoadedComponents<TComponents>>(loaded), signatures) && ...);
+    }
+
+    template <typename ...TComponents>
+    void AddComponents(Registry& registry, std::tuple<LoadedComponents<TComponents>...>& loaded) {
+        auto addComponentType = [&registry](auto& loadedType) {
+            std::vector<Entity> entities;
+            entities.reserve(loadedType.entityIds.size());
+            for (int32_t entityId: loadedType.entityIds) {
+                entities.push_back(registry.GetEntity(entityId));
+            }
+            registry.AddComponents(entities, std::move(loadedType.components));
+        };
+        (addComponentType(std::get<LoadedComponents<TComponents>>(loaded)), ...);
+    }
+}
+
+uint64_t Snapshot::GetSchemaHash() {
+    static const uint64_t schemaHash = HashComponentTypes(Hash(&FORMAT_VERSION, sizeof(FORMAT_VERSION)), ComponentManifest());
+    return schemaHash;
+}
+
+template <typename TComponent>
+void Snapshot::WriteComponentType(SnapshotWriter& writer, Registry& registry, const std::vector<Entity>& entities) {
+    const auto componentId = Component<TComponent>::GetId();
+
+    std::vector<int32_t> entityIds;
+    for (Entity entity: entities) {
+        if (registry.m_entityComponentSignatures[entity.GetId()].test(componentId)) {
+            entityIds.push_back(entity.GetId());
+        }
+    }
+    writer.Write(static_cast<uint32_t>(entityIds.size()));
+    writer.Write(entityIds.data(), entityIds.size() * sizeof(int32_t));
+
+    if constexpr (ComponentSerializer<TComponent>::isRaw) {
+        char* bytes = writer.Append(entityIds.size() * sizeof(TComponent));
+        for (int32_t entityId: entityIds) {
+            std::memcpy(bytes, &registry.GetComponent<const TComponent>(registry.GetEntity(entityId)), sizeof(TComponent));
+            bytes += sizeof(TComponent);
+        }
+    } else {
+        for (int32_t entityId: entityIds) {
+            ComponentSerializer<TComponent>::Write(writer, registry.GetComponent<const TComponent>(registry.GetEntity(entityId)));
+        }
+    }
+}
+
+template <typename ...TComponents>
+void Snapshot::WriteComponents(SnapshotWriter& writer, Registry& registry, const std::vector<Entity>& entities, ComponentList<TComponents...>) {
+    (WriteComponentType<TComponents>(writer, registry, entities), ...);
+}
+
+std::vector<char> Snapshot::Save(Registry& registry) {
+    SnapshotWriter writer;
+    SnapshotHeader header{};
+    static_assert(sizeof(unsigned int) == sizeof(uint32_t), "The generations are written as they are stored");
+    writer.Write(header);
+    const size_t payloadOffset = writer.GetSize();
+
+    // Entity ids, the free ones are written in the order they will be reused
+    const int numEntities = registry.m_numEntities;
+    std::vector<bool> isFree(numEntities, false);
+    for (int entityId: registry.m_freeIds) {
+        isFree[entityId] = true;
+    }
+    std::vector<Entity> entities;
+    std::vector<uint8_t> isActive(numEntities);
+    std::vector<uint64_t> signatures(numEntities * SIGNATURE_WORDS);
+    for (int entityId = 0; entityId < numEntities; entityId++) {
+        isActive[entityId] = registry.m_entityIsActive[entityId];
+        SignatureToWords(registry.m_entityComponentSignatures[entityId], &signatures[entityId * SIGNATURE_WORDS]);
+        if (!isFree[entityId]) {
+            entities.push_back(registry.GetEntity(entityId));
+        }
+    }
+    writer.Write(static_cast<int32_t>(numEntities));
+    writer.Write(registry.m_entityGenerations.data(), numEntities * sizeof(uint32_t));
+    writer.Write(isActive.data(), numEntities * sizeof(uint8_t));
+    writer.Write(signatures.data(), signatures.size() * sizeof(uint64_t));
+    writer.Write(static_cast<uint32_t>(registry.m_freeIds.size()));
+    for (int entityId: registry.m_freeIds) {
+        writer.Write(static_cast<int32_t>(entityId));
+    }
+
+    // Tags and groups by name, their ids depend on the order they were first used
+    const auto tagNames = GetNames(Registry::m_tagIds);
+    writer.Write(static_cast<uint32_t>(registry.entityPerTag.size()));
+    for (const auto& tag: registry.entityPerTag) {
+        writer.WriteString(tagNames[tag.first]);
+        writer.Write(static_cast<int32_t>(tag.second.GetId()));
+    }
+    const auto groupNames = GetNames(Registry::m_groupIds);
+    writer.Write(static_cast<uint32_t>(registry.entitiesPerGroup.size()));
+    for (size_t group = 0; group < registry.entitiesPerGroup.size(); group++) {
+        writer.WriteString(group < groupNames.size() ? groupNames[group] : std::string());
+        writer.Write(static_cast<uint32_t>(registry.entitiesPerGroup[group].size()));
+        for (Entity entity: registry.entitiesPerGroup[group]) {
+            writer.Write(static_cast<int32_t>(entity.GetId()));
+        }
+    }
+
+    // One block per component type, in the order of the manifest
+    WriteComponents(writer, registry, entities, ComponentManifest());
+
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.formatVersion = FORMAT_VERSION;
+    header.numComponentTypes = MAX_COMPONENTS;
+    header.schemaHash = GetSchemaHash();
+    header.payloadSize = writer.GetSize() - payloadOffset;
+    header.payloadChecksum = Hash(writer.GetData(payloadOffset), header.payloadSize);
+    std::memcpy(writer.GetData(0), &header, sizeof(header));
+    return writer.Release();
+}
+
+bool Snapshot::SaveToFile(Registry& registry, const std::string& path) {
+    const auto blob = Save(registry);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(blob.data(), blob.size());
+    if (!file) {
+        Logger::Error("Could not write the snapshot " + path);
+        return false;
+    }
+    Logger::Log("Snapshot saved to " + path + " (" + std::to_string(blob.size()) + " bytes)");
+    return true;
+}
+
+bool Snapshot::Load(Registry& registry, const char* data, size_t size, const ScriptResolver& scriptResolver) {
+    SnapshotHeader header;
+    if (size < sizeof(header)) {
+        Logger::Error("Snapshot is too small");
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.formatVersion != FORMAT_VERSION) {
+        Logger::Error("Not a snapshot, or a snapshot of an older format");
+        return false;
+    }
+    if (header.schemaHash != GetSchemaHash()) {
+        Logger::Error("Snapshot was written with other components, it can not be loaded");
+        return false;
+    }
+    const char* payload = data + sizeof(header);
+    if (header.payloadSize != size - sizeof(header) || header.payloadChecksum != Hash(payload, header.payloadSize)) {
+        Logger::Error("Snapshot is truncated or damaged");
+        return false;
+    }
+
+    // The whole payload is read and checked first, the registry is only changed once it is good
+    const auto numEntities = SnapshotReader(payload, header.payloadSize, nullptr).Read<int32_t>();
+    if (numEntities < 0 || static_cast<uint64_t>(numEntities) > header.payloadSize) {
+        Logger::Error("Snapshot has an invalid number of entities");
+        return false;
+    }
+
+    // The loaded entities get generations newer than every handle taken from the registry so far
+    std::vector<uint32_t> savedGenerations(numEntities);
+    std::vector<uint32_t> loadedGenerations(numEntities);
+    SnapshotReader reader(payload, header.payloadSize, &registry);
+    reader.Read<int32_t>();
+    reader.Read(savedGenerations.data(), numEntities * sizeof(uint32_t));
+    for (int entityId = 0; entityId < numEntities; entityId++) {
+        const uint32_t currentGeneration = entityId < static_cast<int>(registry.m_entityGenerations.size()) ? registry.m_entityGenerations[entityId] : 0;
+        loadedGenerations[entityId] = std::max(savedGenerations[entityId], currentGeneration + 1);
+    }
+    reader.SetGenerations(&savedGenerations, &loadedGenerations);
+
+    std::vector<uint8_t> isActive(numEntities);
+    std::vector<uint64_t> signatureWords(numEntities * SIGNATURE_WORDS);
+    reader.Read(isActive.data(), numEntities * sizeof(uint8_t));
+    reader.Read(signatureWords.data(), signatureWords.size() * sizeof(uint64_t));
+
+    std::vector<bool> isFree(numEntities, false);
+    std::vector<int> freeIds;
+    const auto numFreeIds = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < numFreeIds && reader.IsValid(); i++) {
+        const auto entityId = reader.Read<int32_t>();
+        if (entityId >= 0 && entityId < numEntities && !isFree[entityId]) {
+            isFree[entityId] = true;
+            freeIds.push_back(entityId);
+        }
+    }
+
+    std::vector<std::pair<std::string, int32_t>> tags;
+    const auto numTags = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < numTags && reader.IsValid(); i++) {
+        auto tag = reader.ReadString();
+        const auto entityId = reader.Read<int32_t>();
+        if (entityId >= 0 && entityId < numEntities) {
+            tags.emplace_back(std::move(tag), entityId);
+        }
+    }
+    std::vector<std::pair<std::string, std::vector<int32_t>>> groups;
+    const auto numGroups = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < numGroups && reader.IsValid(); i++) {
+        auto group = reader.ReadString();
+        const auto numGroupEntities = reader.Read<uint32_t>();
+        std::vector<int32_t> groupEntityIds;
+        for (uint32_t j = 0; j < numGroupEntities && reader.IsValid(); j++) {
+            const auto entityId = reader.Read<int32_t>();
+            if (entityId >= 0 && entityId < numEntities) {
+                groupEntityIds.push_back(entityId);
+            }
+        }
+        if (!groupEntityIds.empty()) {
+            groups.emplace_back(std::move(group), std::move(groupEntityIds));
+        }
+    }
+
+    LoadedComponentTypes<ComponentManifest>::type components;
+    std::vector<Signature> signatures(numEntities);
+    const bool isRead = reader.IsValid() && ReadComponents(reader, numEntities, scriptResolver, components, signatures);
+    if (!isRead || !reader.IsValid() || !reader.IsAtEnd()) {
+        Logger::Error("Snapshot could not be read to the end, nothing was loaded");
+        return false;
+    }
+    for (int entityId = 0; entityId < numEntities; entityId++) {
+        if (signatures[entityId] != WordsToSignature(&signatureWords[entityId * SIGNATURE_WORDS])) {
+            Logger::Error("Snapshot entity " + std::to_string(entityId) + " does not have all its components, nothing was loaded");
+            return false;
+        }
+    }
+
+    // The blob is good, everything bellow replaces the current entities.
+    // Creating the ids in one go sizes every per entity vector, then the state of each id is
+    // restored. The free ids are not alive and do not join the systems.
+    registry.Clear();
+    registry.CreateEntities(numEntities);
+    registry.m_entitiesTobeAdded.clear();
+    for (int entityId = 0; entityId < numEntities; entityId++) {
+        registry.m_entityGenerations[entityId] = loadedGenerations[entityId];
+        registry.m_entityIsActive[entityId] = isActive[entityId] != 0;
+        if (!isFree[entityId]) {
+            registry.m_entitiesTobeAdded.push_back(registry.GetEntity(entityId));
+        }
+    }
+    registry.m_freeIds.assign(freeIds.begin(), freeIds.end());
+
+    for (const auto& tag: tags) {
+        registry.TagEntity(registry.GetEntity(tag.second), Registry::GetTagId(tag.first));
+    }
+    for (const auto& group: groups) {
+        std::vector<Entity> groupEntities;
+        groupEntities.reserve(group.second.size());
+        for (int32_t entityId: group.second) {
+            groupEntities.push_back(registry.GetEntity(entityId));
+        }
+        registry.GroupEntities(groupEntities, Registry::GetGroupId(group.first));
+    }
+
+    AddComponents(registry, components);
+    return true;
+}
+
+bool Snapshot::LoadFromFile(Registry& registry, const std::string& path, const ScriptResolver& scriptResolver) {
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file == -1) {
+        Logger::Error("Could not open the snapshot " + path);
+        return false;
+    }
+    struct stat fileStat;
+    if (fstat(file, &fileStat) == -1 || fileStat.st_size == 0) {
+        close(file);
+        Logger::Error("Could not read the snapshot " + path);
+        return false;
+    }
+    const size_t size = static_cast<size_t>(fileStat.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED) {
+        Logger::Error("Could not map the snapshot " + path);
+        return false;
+    }
+
+    const bool isLoaded = Load(registry, static_cast<const char*>(mapping), size, scriptResolver);
+    munmap(mapping, size);
+    return isLoaded;
+}
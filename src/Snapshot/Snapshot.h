@@ -0,0 +1,188 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "../ECS/ECS.h"
+#include <sol/sol.hpp>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// Snapshot
+///////////////////////////////////////////////////////////////////////////////////////////////
+//// A binary copy of the entities of a Registry: their ids and generations, the free ids, the
+///  sleeping entities, the tags and groups and every component of the ComponentManifest.
+///  Loading it rebuilds the same entities with the same ids without running the LevelLoader,
+///  used for checkpoints and to restart a level from a file in a few milliseconds.
+///  The systems, owning groups, observers and prefabs are not part of it, the game sets them up
+///  before loading (the loaded entities enter the owning groups and the observers are called).
+///  The blob starts with a hash of the component manifest (see GetSchemaHash), a snapshot
+///  written by a build with other components is refused instead of being read as garbage.
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+// Appends values to a growing binary blob
+class SnapshotWriter {
+    private:
+        std::vector<char> m_bytes;
+
+    public:
+        void Write(const void* data, size_t size) {
+            if (size > 0) {
+                std::memcpy(Append(size), data, size);
+            }
+        }
+
+        // Grows the blob by size bytes and returns where they start, to fill them in place
+        char* Append(size_t size) {
+            const size_t offset = m_bytes.size();
+            m_bytes.resize(offset + size);
+            return m_bytes.data() + offset;
+        }
+
+        template <typename T>
+        void Write(const T& value) {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values are written as bytes");
+            Write(&value, sizeof(T));
+        }
+
+        void WriteString(const std::string& value) {
+            Write(static_cast<uint32_t>(value.size()));
+            Write(value.data(), value.size());
+        }
+
+        // Id and generation only, the registry pointer is set again when loading
+        void WriteEntity(Entity entity) {
+            Write(static_cast<int32_t>(entity.GetId()));
+            Write(static_cast<uint32_t>(entity.GetGeneration()));
+        }
+
+        size_t GetSize() const { return m_bytes.size(); }
+        // To fix a value written before its content was known (ex: the size of the blob)
+        char* GetData(size_t offset) { return m_bytes.data() + offset; }
+
+        std::vector<char> Release() { return std::move(m_bytes); }
+};
+
+// Reads the values of a blob in the order they were written. The blob is only borrowed (it can be
+// a mapped file). Reading past its end returns zeros and makes the reader invalid, so a truncated
+// file is detected once at the end instead of after every value.
+class SnapshotReader {
+    private:
+        const char* m_data;
+        size_t m_size;
+        size_t m_offset = 0;
+        bool m_isValid = true;
+
+        // Registry of the entities read by ReadEntity
+        Registry* m_registry;
+
+        // [Index = entity id] generations written in the blob and the ones the entities get when
+        // loaded (see Snapshot::Load), the handles read by ReadEntity follow their entity
+        const std::vector<uint32_t>* m_savedGenerations = nullptr;
+        const std::vector<uint32_t>* m_loadedGenerations = nullptr;
+
+    public:
+        SnapshotReader(const char* data, size_t size, Registry* registry): m_data(data), m_size(size), m_registry(registry) {}
+
+        void Read(void* data, size_t size) {
+            if (size == 0) {
+                return;
+            }
+            if (!m_isValid || size > m_size - m_offset) {
+                m_isValid = false;
+                std::memset(data, 0, size);
+                return;
+            }
+            std::memcpy(data, m_data + m_offset, size);
+            m_offset += size;
+        }
+
+        template <typename T>
+        T Read() {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values are read as bytes");
+            T value;
+            Read(&value, sizeof(T));
+            return value;
+        }
+
+        std::string ReadString() {
+            const auto size = Read<uint32_t>();
+            if (!m_isValid || size > m_size - m_offset) {
+                m_isValid = false;
+                return std::string();
+            }
+            std::string value(m_data + m_offset, size);
+            m_offset += size;
+            return value;
+        }
+
+        void SetGenerations(const std::vector<uint32_t>* savedGenerations, const std::vector<uint32_t>* loadedGenerations) {
+            m_savedGenerations = savedGenerations;
+            m_loadedGenerations = loadedGenerations;
+        }
+
+        Entity ReadEntity() {
+            const auto entityId = Read<int32_t>();
+            auto generation = Read<uint32_t>();
+            // Handles to entities already dead when the blob was written stay dead
+            if (m_savedGenerations && entityId >= 0 && entityId < static_cast<int>(m_savedGenerations->size()) && generation == (*m_savedGenerations)[entityId]) {
+                generation = (*m_loadedGenerations)[entityId];
+            }
+            Entity entity(entityId, generation);
+            entity.m_registry = m_registry;
+            return entity;
+        }
+
+        bool IsValid() const { return m_isValid; }
+        bool IsAtEnd() const { return m_offset == m_size; }
+};
+
+// Gives back the Lua function of a LuaScriptComponent from its name (see LuaScriptComponent::name),
+// the functions can not be written to a snapshot
+typedef std::function<sol::function(const std::string& name)> ScriptResolver;
+
+// How the components of a type are written to a snapshot. Trivially copyable components are
+// copied byte per byte, all of them at once. The other components, and the ones holding Entity
+// handles or pointers, specialize it (see Snapshot.cpp) with:
+//   static void Write(SnapshotWriter& writer, const TComponent& component);
+//   static void Read(SnapshotReader& reader, TComponent& component, const ScriptResolver& scriptResolver);
+template <typename TComponent>
+struct ComponentSerializer {
+    static_assert(std::is_trivially_copyable<TComponent>::value, "ComponentSerializer must be specialized for the components that are not trivially copyable");
+    static constexpr bool isRaw = true;
+};
+
+class Snapshot {
+    private:
+        // To bump when the blob layout or a ComponentSerializer changes
+        static constexpr uint32_t FORMAT_VERSION = 1;
+
+        template <typename ...TComponents>
+        static void WriteComponents(SnapshotWriter& writer, Registry& registry, const std::vector<Entity>& entities, ComponentList<TComponents...>);
+
+        template <typename TComponent>
+        static void WriteComponentType(SnapshotWriter& writer, Registry& registry, const std::vector<Entity>& entities);
+
+    public:
+        // Hash of the format version and of the name, size and position of every component type
+        static uint64_t GetSchemaHash();
+
+        // Writes the alive entities of the registry, the pending command buffers are not included
+        static std::vector<char> Save(Registry& registry);
+        static bool SaveToFile(Registry& registry, const std::string& path);
+
+        // Replaces every entity of the registry (see Registry::Clear) by the ones of the snapshot.
+        // Returns false, leaving the registry untouched, when the blob is not a snapshot of this
+        // schema or is damaged: it is read whole before the registry is cleared. The loaded
+        // entities get generations newer than every handle taken before, so those stay dead.
+        // They join their systems at the next Registry::Update().
+        // Without a scriptResolver the LuaScriptComponents are loaded without a function.
+        static bool Load(Registry& registry, const char* data, size_t size, const ScriptResolver& scriptResolver = nullptr);
+        // Maps the file instead of reading it, the components are copied straight out of the mapping
+        static bool LoadFromFile(Registry& registry, const std::string& path, const ScriptResolver& scriptResolver = nullptr);
+};
+
+#endif
@@ -2,8 +2,10 @@
 #define ANIMATIONSYTEM_H
 
 #include "../ECS/ECS.h"
+#include "../Game/GameClock.h"
 #include "../Components/AnimationComponent.h"
 #include "../Components/SpriteComponent.h"
+#include "../Scheduler/ParallelForEach.h"
 #include <SDL2/SDL.h>
 #include <math.h>
 
@@ -12,17 +14,20 @@ class AnimationSystem: public System {
         AnimationSystem() {
             RequireComponent<SpriteComponent>();
             RequireComponent<AnimationComponent>();
+            WritesComponent<SpriteComponent>();
+            WritesComponent<AnimationComponent>();
         }
 
-        void Update() {
-            for (auto entity: GetSystemEntities()) {
+        void Update(WorkerPool& workerPool) {
+            const auto ticks = GameClock::GetTicks();
+            ParallelForEach(workerPool, GetSystemEntities(), [ticks](Entity entity) {
                 auto& animation = entity.GetComponent<AnimationComponent>();
                 auto& sprite = entity.GetComponent<SpriteComponent>();
                 
 
-                animation.currentFrame = fmod(((SDL_GetTicks() - animation.startTime) * animation.frameSpeedRate / 1000.0), animation.numFrames);
+                animation.currentFrame = fmod(((ticks - animation.startTime) * animation.frameSpeedRate / 1000.0), animation.numFrames);
                 sprite.srcRect.x = animation.currentFrame * sprite.width;
-            };
+            });
         };
 };
 
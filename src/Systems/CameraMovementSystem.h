@@ -16,7 +16,7 @@ class CameraMovementSystem: public System {
 
         void Update(SDL_Rect& camera) {
             for(auto entity : GetSystemEntities()){
-                auto transform = entity.GetComponent<TransformComponent>();
+                auto transform = entity.GetComponent<const TransformComponent>();
 
 
                 if (transform.position.x  + (camera.w / 2) < Game::m_mapWidth){
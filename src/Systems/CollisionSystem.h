@@ -11,35 +11,53 @@
 #include "../Events/CollisionEvent.h"
 
 class CollisionSystem: public System {
+    private:
+        struct Collider {
+            Entity entity;
+            const TransformComponent* transform;
+            BoxColliderComponent* collider;
+        };
+
+        std::vector<Collider> m_colliders;
 
     public:
         CollisionSystem() {
             RequireComponent<BoxColliderComponent>();
             RequireComponent<TransformComponent>();
+            WritesComponent<BoxColliderComponent>();
+
+            // The collision events are only queued, the other systems (damage, movement, ...) handle
+            // them after the update systems (see EventBus::DispatchQueuedEvents), so this one does
+            // not need to run alone
         }
 
-        void Update(bool SDLCollision, std::unique_ptr<EventBus>& ptr_eventBus) {
-            // Check all entities that has a boxcollider
-            // to see if they are colliding with each other
-            auto entities = GetSystemEntities();
+        void Update(bool SDLCollision, std::unique_ptr<Registry>& registry, std::unique_ptr<EventBus>& ptr_eventBus) {
+            // Gather all entities that has a boxcollider with pointers to their components once,
+            // so the O(n^2) loop bellow does not look components up for every pair.
+            m_colliders.clear();
+            registry->View<const TransformComponent, BoxColliderComponent>().Each([&](Entity entity, const TransformComponent& transform, BoxColliderComponent& collider) {
+                m_colliders.push_back({ entity, &transform, &collider });
+            });
+
+            // Check all of them to see if they are colliding with each other
             bool collided = false;
 
-            for(auto i = entities.begin(); i != entities.end(); i++) {
-                Entity a = *i;
-                auto aTransform = a.GetComponent<TransformComponent>();
-                auto& aCollider = a.GetComponent<BoxColliderComponent>();
+            for(auto i = m_colliders.begin(); i != m_colliders.end(); i++) {
+                Entity a = i->entity;
+                const auto& aTransform = *i->transform;
+                auto& aCollider = *i->collider;
 
                 // Checking only the ones to the right, that still needs to be checked
-                for(auto j = i; j != entities.end(); j++) {
-                    Entity b = *j;
+                for(auto j = i; j != m_colliders.end(); j++) {
+                    Entity b = j->entity;
 
                     // Bypass if they are the same entity 
                     if (a == b) {
                         continue;
                     }
 
-                    auto bTransform = b.GetComponent<TransformComponent>();
-                    auto& bCollider = b.GetComponent<BoxColliderComponent>();
+                    const auto& bTransform = *j->transform;
+                    auto& bCollider = *j->collider;
                     
 
                     if (!SDLCollision) {
@@ -70,8 +88,8 @@ class CollisionSystem: public System {
                         aCollider.isColliding = true;
                         bCollider.isColliding = true;
 
-                        // Emit an event
-                        ptr_eventBus->EmitEvent<CollisionEvent>(a, b);
+                        // Queue an event
+                        ptr_eventBus->QueueEvent<CollisionEvent>(a, b);
 
                     } 
                     // Not Colliding
@@ -10,41 +10,44 @@
 #include "../Logger/Logger.h"
 
 class DamageSystem: public System {
+    private:
+        // Interned tag and group ids, looked up once
+        const TagId m_playerTag = Registry::GetTagId("player");
+        const GroupId m_projectilesGroup = Registry::GetGroupId("projectiles");
+        const GroupId m_enemiesGroup = Registry::GetGroupId("enemies");
+
+        Subscription m_playerHitSubscription;
+        Subscription m_enemyHitSubscription;
+
     public:
         DamageSystem() {
             RequireComponent<BoxColliderComponent>();
         }
 
+        // Only the collisions of a projectile with the player or an enemy reach this system,
+        // the projectile is always the first entity of the events
         void SubscribeToCollisionEvent(std::unique_ptr<EventBus>& eventBus){
-            eventBus->SubscribeToEvent<CollisionEvent>(this, &DamageSystem::onCollision);
+            const auto projectile = EntityFilter().InGroup(m_projectilesGroup).Require<ProjectileComponent>();
+            m_playerHitSubscription = eventBus->SubscribeToEventBatches<CollisionEvent>(
+                { projectile, EntityFilter().WithTag(m_playerTag).Require<HealthComponent>() }, this, &DamageSystem::OnProjectilesHitPlayer);
+            m_enemyHitSubscription = eventBus->SubscribeToEventBatches<CollisionEvent>(
+                { projectile, EntityFilter().InGroup(m_enemiesGroup).Require<HealthComponent>() }, this, &DamageSystem::OnProjectilesHitEnemies);
         }
 
-        void onCollision(CollisionEvent& event) {
-            Entity a = event.a;
-            Entity b = event.b;
-
-            Logger::Log("The Damage System recieved an event collision between entities " + std::to_string(a.GetId()) + " and " + std::to_string(b.GetId()));
-            if (a.BelongsToGroup("projectiles") && b.HasTag("player")) {
-                OnProjectileHitsPlayer(a, b); // a is the projectile and b is the player 
-            }
-
-            if (b.BelongsToGroup("projectiles") && a.HasTag("player")) {
-                OnProjectileHitsPlayer(b, a); // b is the projectile and a is the player 
-            }
-
-
-            if (a.BelongsToGroup("projectiles") && b.BelongsToGroup("enemies")) {
-                OnProjectileHitsEnemy(a, b);
+        void OnProjectilesHitPlayer(EventSpan<CollisionEvent> events) {
+            for (const auto& event: events) {
+                OnProjectileHitsPlayer(event.a, event.b);
             }
+        }
 
-            if (b.BelongsToGroup("projectiles") && a.BelongsToGroup("enemies")) {
-                OnProjectileHitsEnemy(b, a);
+        void OnProjectilesHitEnemies(EventSpan<CollisionEvent> events) {
+            for (const auto& event: events) {
+                OnProjectileHitsEnemy(event.a, event.b);
             }
-
         }
 
         void OnProjectileHitsEnemy(Entity projectile, Entity enemy) {
-            auto projectileComponent = projectile.GetComponent<ProjectileComponent>();
+            auto projectileComponent = projectile.GetComponent<const ProjectileComponent>();
             
             // Only damage the enemy if the projectile is friendly (player)
             if (projectileComponent.isFriendly) {
@@ -61,7 +64,7 @@ class DamageSystem: public System {
         }
 
         void OnProjectileHitsPlayer(Entity projectile, Entity player) {
-            auto projectileComponent = projectile.GetComponent<ProjectileComponent>();
+            auto projectileComponent = projectile.GetComponent<const ProjectileComponent>();
 
             if(!projectileComponent.isFriendly) {
                 // Reduce the health of the player by the projectile hit percentDamage
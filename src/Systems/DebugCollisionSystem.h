@@ -17,8 +17,8 @@ class DebugCollisionSystem: public System {
         void Update(SDL_Renderer* renderer, SDL_Rect& camera) {
 
             for (auto entity : GetSystemEntities()) {
-                auto entityTransform = entity.GetComponent<TransformComponent>();
-                auto entityCollider = entity.GetComponent<BoxColliderComponent>();
+                auto entityTransform = entity.GetComponent<const TransformComponent>();
+                auto entityCollider = entity.GetComponent<const BoxColliderComponent>();
 
                 SDL_Rect debugRect{
                     static_cast<int>(entityTransform.position.x + entityCollider.offset.x - camera.x),
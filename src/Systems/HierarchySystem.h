@@ -0,0 +1,198 @@
+#ifndef HIERARCHYSYSTEM_H
+#define HIERARCHYSYSTEM_H
+
+#include "../ECS/ECS.h"
+#include "../Components/TransformComponent.h"
+#include "../Components/ParentComponent.h"
+#include "../Components/ChildrenComponent.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include <cmath>
+
+// Places the children entities (see ParentComponent) relative to their parent. The TransformComponent
+// of a child is its world transform, computed from its parent and cached until one of them changes,
+// so the other systems (render, collision, camera...) read every transform the same way.
+// The children are kept sorted by depth, a parent always comes before its children, so one pass in
+// that order places a whole hierarchy. Only the children whose parent transform or local transform
+// was written since the last pass are computed again (see Registry::AdvanceChangeTick).
+// A child is killed with its parent, in the same Registry::Update().
+class HierarchySystem: public System {
+    private:
+        // Every child, sleeping ones included, the ones closer to the root first
+        std::vector<Entity> m_entitiesByDepth;
+
+        // Set when a child is attached or detached, the order is sorted again before the next pass
+        bool m_isOrderDirty = false;
+
+        // Tick of the last pass, the transforms written after it must be propagated again
+        unsigned int m_lastChangeTick = 0;
+
+        void SortByDepth(std::unique_ptr<Registry>& registry) {
+            // Drop the entities killed or detached since the last sort, and the ones attached twice
+            std::sort(m_entitiesByDepth.begin(), m_entitiesByDepth.end());
+            m_entitiesByDepth.erase(std::unique(m_entitiesByDepth.begin(), m_entitiesByDepth.end()), m_entitiesByDepth.end());
+            m_entitiesByDepth.erase(std::remove_if(m_entitiesByDepth.begin(), m_entitiesByDepth.end(), [&](Entity entity) {
+                return !registry->IsAlive(entity) || !entity.HasComponent<ParentComponent>();
+            }), m_entitiesByDepth.end());
+
+            // [Key = entity id]
+            std::unordered_map<int, int> depths;
+            depths.reserve(m_entitiesByDepth.size());
+            for (Entity entity: m_entitiesByDepth) {
+                depths[entity.GetId()] = GetDepth(registry, entity, depths);
+            }
+
+            // Sorting by id inside a depth keeps the order the same from one run to the other
+            std::sort(m_entitiesByDepth.begin(), m_entitiesByDepth.end(), [&](Entity a, Entity b) {
+                const int depthA = depths[a.GetId()];
+                const int depthB = depths[b.GetId()];
+                return depthA != depthB ? depthA < depthB : a < b;
+            });
+        }
+
+        // Number of parents above the entity, walking up until a known depth or a root is found
+        static int GetDepth(std::unique_ptr<Registry>& registry, Entity entity, std::unordered_map<int, int>& depths) {
+            auto depth = depths.find(entity.GetId());
+            if (depth != depths.end()) {
+                return depth->second;
+            }
+            if (!registry->IsAlive(entity) || !entity.HasComponent<ParentComponent>()) {
+                return 0;
+            }
+            return GetDepth(registry, entity.GetComponent<const ParentComponent>().parent, depths) + 1;
+        }
+
+        static void RemoveChild(Entity parent, Entity child) {
+            if (!parent.IsAlive() || !parent.HasComponent<ChildrenComponent>()) {
+                return;
+            }
+            auto& children = parent.GetComponent<ChildrenComponent>().children;
+            children.erase(std::remove(children.begin(), children.end(), child), children.end());
+        }
+
+        static void ComputeWorldTransform(const TransformComponent& parentTransform, const ParentComponent& link, TransformComponent& transform) {
+            const double angle = glm::radians(parentTransform.rotation);
+            const double cosAngle = std::cos(angle);
+            const double sinAngle = std::sin(angle);
+            const glm::vec2 offset = link.localPosition * parentTransform.scale;
+
+            transform.position.x = parentTransform.position.x + offset.x * cosAngle - offset.y * sinAngle;
+            transform.position.y = parentTransform.position.y + offset.x * sinAngle + offset.y * cosAngle;
+            transform.scale = parentTransform.scale * link.localScale;
+            transform.rotation = parentTransform.rotation + link.localRotation;
+        }
+
+    public:
+        HierarchySystem() {
+            RequireComponent<ParentComponent>();
+            RequireComponent<TransformComponent>();
+        }
+
+        // Keeps track of the children, ParentComponent can also be added by a prefab or a level file
+        void ObserveHierarchy(std::unique_ptr<Registry>& registry) {
+            registry->OnComponentAdded<ParentComponent>([this](Entity entity) {
+                m_entitiesByDepth.push_back(entity);
+                m_isOrderDirty = true;
+            });
+            registry->OnComponentRemoved<ParentComponent>([this](Entity entity) {
+                RemoveChild(entity.GetComponent<const ParentComponent>().parent, entity);
+                m_isOrderDirty = true;
+            });
+            // The children of a killed parent are killed in the same Registry::Update(), before
+            // they are rendered once more around a dead parent
+            registry->OnComponentRemoved<ChildrenComponent>([](Entity entity) {
+                for (Entity child: entity.GetComponent<const ChildrenComponent>().children) {
+                    if (child.IsAlive()) {
+                        child.Kill();
+                    }
+                }
+            });
+        }
+
+        // Attaches the child to the parent, replacing its previous parent. The child is placed at
+        // the local position, scale and rotation relative to the parent by the next Update().
+        void SetParent(Entity child, Entity parent, glm::vec2 localPosition = glm::vec2(0,0), glm::vec2 localScale = glm::vec2(1,1), double localRotation = 0.0) {
+            if (!child.IsAlive() || !parent.IsAlive()) {
+                Logger::Error("Trying to attach an entity that is not alive");
+                return;
+            }
+            for (Entity ancestor = parent; ancestor.IsAlive(); ancestor = ancestor.GetComponent<const ParentComponent>().parent) {
+                if (ancestor == child) {
+                    Logger::Error("Trying to attach an entity to one of its own children");
+                    return;
+                }
+                if (!ancestor.HasComponent<ParentComponent>()) {
+                    break;
+                }
+            }
+
+            if (child.HasComponent<ParentComponent>()) {
+                RemoveChild(child.GetComponent<const ParentComponent>().parent, child);
+            }
+            child.AddComponent<ParentComponent>(parent, localPosition, localScale, localRotation);
+
+            if (!parent.HasComponent<ChildrenComponent>()) {
+                parent.AddComponent<ChildrenComponent>();
+            }
+            parent.GetComponent<ChildrenComponent>().children.push_back(child);
+
+            m_isOrderDirty = true;
+        }
+
+        // Detaches the child from its parent, it stays where it was placed last
+        void RemoveParent(Entity child) {
+            if (child.HasComponent<ParentComponent>()) {
+                child.RemoveComponent<ParentComponent>();
+            }
+        }
+
+        // Must run on the main thread after Registry::Update(), so the transforms written during the
+        // frame are all propagated before rendering
+        void Update(std::unique_ptr<Registry>& registry) {
+            // A new order places every child again, their parent changed or they are new
+            const bool isNewOrder = m_isOrderDirty;
+            if (m_isOrderDirty) {
+                SortByDepth(registry);
+                m_isOrderDirty = false;
+            }
+
+            const auto sinceTick = m_lastChangeTick;
+            for (Entity entity: m_entitiesByDepth) {
+                // Sleeping children follow their parent too, so they are in place when they wake up
+                if (!registry->IsAlive(entity) || !entity.HasComponent<ParentComponent>() || !entity.HasComponent<TransformComponent>()) {
+                    continue;
+                }
+
+                // Parents are killed with their children already, this catches the other ways a
+                // parent can disappear (ex: its ChildrenComponent removed before it was killed)
+                const auto& link = entity.GetComponent<const ParentComponent>();
+                if (!link.parent.IsAlive()) {
+                    entity.Kill();
+                    continue;
+                }
+                if (!link.parent.HasComponent<TransformComponent>()) {
+                    continue;
+                }
+
+                // The transform of a child is also placed again when something else wrote it
+                const bool isDirty = isNewOrder ||
+                    registry->GetComponentChangeTick<TransformComponent>(link.parent) > sinceTick ||
+                    registry->GetComponentChangeTick<ParentComponent>(entity) > sinceTick ||
+                    registry->GetComponentChangeTick<TransformComponent>(entity) > sinceTick;
+                if (!isDirty) {
+                    continue;
+                }
+
+                // Writing the transform stamps it with the current tick, so the children of this
+                // entity, further in the order, are placed again in this same pass
+                ComputeWorldTransform(link.parent.GetComponent<const TransformComponent>(), link, entity.GetComponent<TransformComponent>());
+            }
+
+            // The transforms written from now on are newer than the ones placed above
+            m_lastChangeTick = registry->AdvanceChangeTick();
+        }
+};
+
+#endif
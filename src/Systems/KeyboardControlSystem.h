@@ -13,6 +13,9 @@
 #include "../Events/KeyPressedEvent.h"
 
 class KeyboardControlSystem: public System {
+    private:
+        Subscription m_keyPressedSubscription;
+
     public:
         KeyboardControlSystem() {
             RequireComponent<KeyboardControlledComponent>();
@@ -21,13 +24,13 @@ class KeyboardControlSystem: public System {
         }
 
         void SubscribeToKeyPressedEvents(std::unique_ptr<EventBus>& eventBus) {
-            eventBus->SubscribeToEvent<KeyPressedEvent>(this, &KeyboardControlSystem::onKeyPressed);
+            m_keyPressedSubscription = eventBus->SubscribeToEvent<KeyPressedEvent>(this, &KeyboardControlSystem::onKeyPressed);
         }
 
         void onKeyPressed(KeyPressedEvent& event) {
             // Change the sprite and the velocity of interested entities
             for (auto entity : GetSystemEntities()) {
-                const auto keyboardControl = entity.GetComponent<KeyboardControlledComponent>();
+                const auto keyboardControl = entity.GetComponent<const KeyboardControlledComponent>();
                 auto& sprite = entity.GetComponent<SpriteComponent>();
                 auto& rigidbody = entity.GetComponent<RigidBodyComponent>();
 
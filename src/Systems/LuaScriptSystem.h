@@ -7,11 +7,12 @@
 #include "../Components/RigidBodyComponent.h"
 #include "../Components/AnimationComponent.h"
 #include "../Components/ProjectileEmitterComponent.h"
+#include "../Components/ParentComponent.h"
 #include <tuple>
 
 std::tuple<double, double> GetEntityPosition(Entity entity) {
     if (entity.HasComponent<TransformComponent>()) {
-        const auto transform = entity.GetComponent<TransformComponent>();
+        const auto transform = entity.GetComponent<const TransformComponent>();
         return std::make_tuple(transform.position.x, transform.position.y);
     } else {
         Logger::Error("Trying to get the position of an entity that has no transform component");
@@ -21,7 +22,7 @@ std::tuple<double, double> GetEntityPosition(Entity entity) {
 
 std::tuple<double, double> GetEntityVelocity(Entity entity) {
     if (entity.HasComponent<RigidBodyComponent>()) {
-        const auto rigidbody = entity.GetComponent<RigidBodyComponent>();
+        const auto rigidbody = entity.GetComponent<const RigidBodyComponent>();
         return std::make_tuple(rigidbody.velocity.x, rigidbody.velocity.y);
     } else {
         Logger::Error("Trying to get the velocity of an entity that has no rigidbody component");
@@ -29,8 +30,13 @@ std::tuple<double, double> GetEntityVelocity(Entity entity) {
     }
 }
 
+// The position and rotation of a child entity are relative to its parent (see HierarchySystem)
 void SetEntityPosition(Entity entity, double x, double y) {
-    if (entity.HasComponent<TransformComponent>()) {
+    if (entity.HasComponent<ParentComponent>()) {
+        auto& link = entity.GetComponent<ParentComponent>();
+        link.localPosition.x = x;
+        link.localPosition.y = y;
+    } else if (entity.HasComponent<TransformComponent>()) {
         auto& transform = entity.GetComponent<TransformComponent>();
         transform.position.x = x;
         transform.position.y = y;
@@ -50,7 +56,10 @@ void SetEntityVelocity(Entity entity, double x, double y) {
 }
 
 void SetEntityRotation(Entity entity, double angle) {
-    if (entity.HasComponent<TransformComponent>()) {
+    if (entity.HasComponent<ParentComponent>()) {
+        auto& link = entity.GetComponent<ParentComponent>();
+        link.localRotation = angle;
+    } else if (entity.HasComponent<TransformComponent>()) {
         auto& transform = entity.GetComponent<TransformComponent>();
         transform.rotation = angle;
     } else {
@@ -82,6 +91,9 @@ class LuaScriptSystem: public System {
     public:
         LuaScriptSystem() {
             RequireComponent<LuaScriptComponent>();
+
+            // Scripts can read and change anything in the registry
+            RequireExclusiveAccess();
         }
 
         void CreateLuaBindings(sol::state& lua) {
@@ -90,9 +102,12 @@ class LuaScriptSystem: public System {
             lua.new_usertype<Entity>(
                 "entity",
                 "get_id", &Entity::GetId,
+                "is_alive", &Entity::IsAlive,
+                "is_active", &Entity::IsActive,
+                "set_active", &Entity::SetActive,
                 "destroy", &Entity::Kill,
-                "has_tag", &Entity::HasTag,
-                "belongs_to_group", &Entity::BelongsToGroup
+                "has_tag", sol::resolve<bool(const std::string&) const>(&Entity::HasTag),
+                "belongs_to_group", sol::resolve<bool(const std::string&) const>(&Entity::BelongsToGroup)
             );
 
             // Create all the bindings between C++ and Lua functions
@@ -108,7 +123,7 @@ class LuaScriptSystem: public System {
         void Update(double deltaTime, int ellapsedTime) {
             // loop all entities that have a script component and invoke their lua function
             for (auto entity : GetSystemEntities()) {
-                auto script = entity.GetComponent<LuaScriptComponent>();
+                const auto& script = entity.GetComponent<const LuaScriptComponent>();
                 script.func(entity, deltaTime, ellapsedTime);
             }
         }
@@ -7,30 +7,34 @@
 #include "../Components/SpriteComponent.h"
 #include "../EventBus/EventBus.h"
 #include "../Events/CollisionEvent.h"
+#include "../Scheduler/ParallelForEach.h"
 
 class MovementSystem: public System {
+    private:
+        // Interned tag and group ids, looked up once
+        const TagId m_playerTag = Registry::GetTagId("player");
+        const GroupId m_enemiesGroup = Registry::GetGroupId("enemies");
+        const GroupId m_obstaclesGroup = Registry::GetGroupId("obstacles");
+
+        Subscription m_collisionSubscription;
+
     public:
         MovementSystem() {
             RequireComponent<TransformComponent>();
             RequireComponent<RigidBodyComponent>();
+            WritesComponent<TransformComponent>();
         }
 
         // Subscription to collision events
         void SubscribeToCollisionEvent(const std::unique_ptr<EventBus>& eventBus){
-            eventBus->SubscribeToEvent<CollisionEvent>(this, &MovementSystem::onCollision);
+            // Only the collisions between an enemy (first) and an obstacle (second) reach this system
+            m_collisionSubscription = eventBus->SubscribeToEventBatches<CollisionEvent>(
+                { EntityFilter().InGroup(m_enemiesGroup), EntityFilter().InGroup(m_obstaclesGroup) }, this, &MovementSystem::OnEnemiesHitObstacles);
         }
 
-        // On Collision
-        void onCollision(CollisionEvent& event) {
-            Entity a = event.a;
-            Entity b = event.b;
-
-            if (a.BelongsToGroup("enemies") && b.BelongsToGroup("obstacles")) {
-                OnEnemyHitsObstacle(a, b);
-            }
-
-            if (a.BelongsToGroup("obstacles") && b.BelongsToGroup("enemies")) {
-                OnEnemyHitsObstacle(b, a);
+        void OnEnemiesHitObstacles(EventSpan<CollisionEvent> events) {
+            for (const auto& event: events) {
+                OnEnemyHitsObstacle(event.a, event.b);
             }
         }
 
@@ -51,19 +55,15 @@ class MovementSystem: public System {
             }
         }
 
-        void Update(double deltaTime) {
-            // TODO:
-            
-            // Loop all entities that the system is interested in..
-            for (auto entity: GetSystemEntities()) {
+        void Update(std::unique_ptr<Registry>& registry, double deltaTime, WorkerPool& workerPool) {
+            // Loop all entities that have a transform and a rigid body, straight over the packed pools,
+            // split between the worker threads. Each entity only touches its own transform.
+            ParallelForEach(workerPool, registry->View<TransformComponent, const RigidBodyComponent>(), [&](Entity entity, TransformComponent& transform, const RigidBodyComponent& rigidbody) {
                 // Update entity pos based on its velocity every frame
-                auto& transform = entity.GetComponent<TransformComponent>();
-                const auto rigidbody = entity.GetComponent<RigidBodyComponent>();
-
                 transform.position.x += rigidbody.velocity.x * deltaTime;
                 transform.position.y += rigidbody.velocity.y * deltaTime;
 
-                if (entity.HasTag("player")) {
+                if (entity.HasTag(m_playerTag)) {
                     int paddingLeft = 10;
                     int paddingTop = 10;
                     int paddingRight = 30;
@@ -80,10 +80,10 @@ class MovementSystem: public System {
                     transform.position.y < 0 ||
                     transform.position.y > Game::m_mapHeight
                 );
-                if (isEntityOutsideMap && !entity.HasTag("player")) {
+                if (isEntityOutsideMap && !entity.HasTag(m_playerTag)) {
                     entity.Kill();
                 }
-            }
+            });
         }
 };
 
@@ -2,6 +2,7 @@
 #define PROJECTILEEMITSYSTEM_H
 
 #include "../ECS/ECS.h"
+#include "../Game/GameClock.h"
 #include "../Components/ProjectileEmitterComponent.h"
 #include "../Components/TransformComponent.h"
 #include "../Components/SpriteComponent.h"
@@ -19,16 +20,35 @@
 #include <iostream>
 
 class ProjectileEmitSystem: public System {
+    private:
+        // Interned tag and group ids, looked up once
+        const TagId m_playerTag = Registry::GetTagId("player");
+        const GroupId m_projectilesGroup = Registry::GetGroupId("projectiles");
+
+        // Every projectile starts as a copy of this prefab, the position, velocity and damage
+        // are then set per shot
+        Prefab m_projectilePrefab;
+
+        Subscription m_shootSubscription;
 
     public:
         ProjectileEmitSystem () {
             RequireComponent<ProjectileEmitterComponent>();
             RequireComponent<TransformComponent>();
             RequireComponent<RigidBodyComponent>();
+            ReadsComponent<SpriteComponent>();
+            WritesComponent<ProjectileEmitterComponent>();
+
+            m_projectilePrefab.Group(m_projectilesGroup);
+            m_projectilePrefab.AddComponent<TransformComponent>(glm::vec2(0.0), glm::vec2(1.0), 0.0);
+            m_projectilePrefab.AddComponent<RigidBodyComponent>(glm::vec2(0.0));
+            m_projectilePrefab.AddComponent<SpriteComponent>("bullet-texture", 4, 4, 0, 0, 4);
+            m_projectilePrefab.AddComponent<BoxColliderComponent>(4, 4);
+            m_projectilePrefab.AddComponent<ProjectileComponent>();
         }
 
         void SubscribeToSpaceBarEvent(std::unique_ptr<EventBus>& eventBus){
-            eventBus->SubscribeToEvent<ShootProjectileEvent>(this, &ProjectileEmitSystem::OnShoot);
+            m_shootSubscription = eventBus->SubscribeToEvent<ShootProjectileEvent>(this, &ProjectileEmitSystem::OnShoot);
         }
 
         void OnShoot(ShootProjectileEvent& event) {
@@ -36,10 +56,10 @@ class ProjectileEmitSystem: public System {
             for (auto entity : GetSystemEntities()) {
 
                 // Is the player
-                if(entity.HasTag("player")) {
+                if(entity.HasTag(m_playerTag)) {
 
-                    const auto transform = entity.GetComponent<TransformComponent>();
-                    const auto rigidBody = entity.GetComponent<RigidBodyComponent>();
+                    const auto& transform = entity.GetComponent<const TransformComponent>();
+                    const auto& rigidBody = entity.GetComponent<const RigidBodyComponent>();
                     auto& projectileEmitter = entity.GetComponent<ProjectileEmitterComponent>();
 
                     glm::vec2 projectilePosition = transform.position;
@@ -68,7 +88,7 @@ class ProjectileEmitSystem: public System {
 
             // For every enimy entity we leave them shooting
             for (auto entity : GetSystemEntities()) {
-                const auto rigidBody = entity.GetComponent<RigidBodyComponent>();
+                const auto& rigidBody = entity.GetComponent<const RigidBodyComponent>();
                 auto& projectileEmitter = entity.GetComponent<ProjectileEmitterComponent>();
                 if (!projectileEmitter.isFriendly) {
 
@@ -84,11 +104,11 @@ class ProjectileEmitSystem: public System {
 
         // If the entity has Sprite we position our new projectile in the center
         void CenterProjectile(Entity entity, glm::vec2& projectilePosition) {
-            const auto transform = entity.GetComponent<TransformComponent>();
+            const auto& transform = entity.GetComponent<const TransformComponent>();
             projectilePosition = transform.position;
             if (entity.HasComponent<SpriteComponent>()) {
 
-                auto sprite = entity.GetComponent<SpriteComponent>();
+                const auto& sprite = entity.GetComponent<const SpriteComponent>();
                 projectilePosition.x += ((transform.scale.x * sprite.width)  / 2);
                 projectilePosition.y += ((transform.scale.y * sprite.height) / 2);
             }
@@ -98,18 +118,17 @@ class ProjectileEmitSystem: public System {
             
             auto& projectileEmitter = entity.GetComponent<ProjectileEmitterComponent>();
             // Check if its time to re-emit a new projectile
-            if ((int)(SDL_GetTicks() - projectileEmitter.lastEmissionTime) > (int)(projectileEmitter.projectileRateOfFire)) {
-
-                // Add a new projectile entity to the registry
-                Entity projectile = registry->CreateEntity();
-                projectile.Group("projectiles");
-                projectile.AddComponent<TransformComponent>(projectilePosition, glm::vec2(1.0), 0.0);
-                projectile.AddComponent<RigidBodyComponent>(projectileVelocity);
-                projectile.AddComponent<SpriteComponent>("bullet-texture", 4, 4, 0, 0, 4);
-                projectile.AddComponent<BoxColliderComponent>(4,4);
-                projectile.AddComponent<ProjectileComponent>(projectileEmitter.isFriendly, projectileEmitter.hitPercentDamage, projectileEmitter.projectileDuration);
-
-                projectileEmitter.lastEmissionTime = SDL_GetTicks();
+            if ((int)(GameClock::GetTicks() - projectileEmitter.lastEmissionTime) > (int)(projectileEmitter.projectileRateOfFire)) {
+
+                // Record a new projectile entity, it is created at the next registry update.
+                // The command buffer belongs to this thread, so the system can run alongside others.
+                CommandBuffer& commands = registry->GetCommandBuffer();
+                Entity projectile = commands.Instantiate(entity, m_projectilePrefab);
+                commands.AddComponent<TransformComponent>(projectile, projectilePosition, glm::vec2(1.0), 0.0);
+                commands.AddComponent<RigidBodyComponent>(projectile, projectileVelocity);
+                commands.AddComponent<ProjectileComponent>(projectile, projectileEmitter.isFriendly, projectileEmitter.hitPercentDamage, projectileEmitter.projectileDuration);
+
+                projectileEmitter.lastEmissionTime = GameClock::GetTicks();
             }
         }
     
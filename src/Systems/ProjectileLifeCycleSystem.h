@@ -2,6 +2,7 @@
 #define PROJECTILELIFECYCLESYSTEM_H
 
 #include "../ECS/ECS.h"
+#include "../Game/GameClock.h"
 #include "../Components/ProjectileEmitterComponent.h"
 #include "../Components/TransformComponent.h"
 #include "../Components/SpriteComponent.h"
@@ -24,10 +25,10 @@ class ProjectileLifeCycleSystem: public System {
 
         void Update() {
             for(auto entity : GetSystemEntities()) {
-                auto projectile = entity.GetComponent<ProjectileComponent>();
+                auto projectile = entity.GetComponent<const ProjectileComponent>();
 
                 // Kill projectiles after they hit they duration limit
-                if ((int)(SDL_GetTicks() - projectile.startTime) > (int)(projectile.duration)) {
+                if ((int)(GameClock::GetTicks() - projectile.startTime) > (int)(projectile.duration)) {
                     entity.Kill();
                 }
             }
@@ -2,6 +2,8 @@
 #define RENDERGUISYSTEM_H
 
 #include "../ECS/ECS.h"
+#include "../Scheduler/SystemScheduler.h"
+#include "../Memory/FrameArena.h"
 #include <SDL2/SDL.h>
 #include <imgui/imgui.h>
 #include <imgui/imgui_sdl.h>
@@ -100,7 +102,7 @@ class RenderGUISystem: public System {
     public:
         RenderGUISystem() = default;
 
-        void Update(const std::unique_ptr<Registry>& registry, const SDL_Rect& camera){
+        void Update(const std::unique_ptr<Registry>& registry, const SDL_Rect& camera, const SchedulerFrameStats& schedulerStats, const FrameArenaStats& frameArenaStats){
             ImGui::NewFrame();
             if (ImGui::BeginMainMenuBar())
             {
@@ -132,6 +134,7 @@ class RenderGUISystem: public System {
                 static int velX = 0;
                 static int velY = 0;
                 static int health = 100;
+                static int amount = 1;
                 static float rotation = 0.0;
                 static float projAngle = 0.0;
                 static float projSpeed = 100.0;
@@ -176,13 +179,18 @@ class RenderGUISystem: public System {
                 if (ImGui::CollapsingHeader("Health", ImGuiTreeNodeFlags_DefaultOpen)) {
                     ImGui::SliderInt("%", &health, 0, 100);
                 }
+                ImGui::Spacing();
+
+                // Number of copies of the enemy to spawn at once
+                ImGui::SliderInt("amount", &amount, 1, 100);
 
                 ImGui::Spacing();
                 ImGui::Separator();
                 ImGui::Spacing();
 
                 if(ImGui::Button("Create new enemy")){
-                    Entity enemy = registry->CreateEntity();
+                    // The enemy is built once as a prefab and copied amount times
+                    Prefab enemy;
                     enemy.Group("enemies");
                     enemy.AddComponent<TransformComponent>(glm::vec2(posX, posY), glm::vec2(scaleX, scaleY), rotation);
                     enemy.AddComponent<RigidBodyComponent>(glm::vec2(velX, velY));
@@ -192,6 +200,7 @@ class RenderGUISystem: public System {
                     double projVelY = sin(projAngle) * projSpeed; // convert from angle-speed to y-value
                     enemy.AddComponent<ProjectileEmitterComponent>(glm::vec2(projVelX, projVelY), projRepeat * 1000, projDuration * 1000, 10, false);
                     enemy.AddComponent<HealthComponent>(health);
+                    registry->Instantiate(enemy, amount);
 
                     // Reset all input values after we create a new enemy
                     posX = posY = rotation = projAngle = 0;
@@ -199,6 +208,7 @@ class RenderGUISystem: public System {
                     projRepeat = projDuration = 10;
                     projSpeed = 100;
                     health = 100;
+                    amount = 1;
                 }
             }
             ImGui::End();
@@ -216,6 +226,29 @@ class RenderGUISystem: public System {
             }
             ImGui::End();
 
+            // Display the time spent by the update systems in the last frame
+            if (ImGui::Begin("System scheduler")) {
+                ImGui::Text("frame %.3f ms, serial %.3f ms, critical path %.3f ms", schedulerStats.frameMs, schedulerStats.serialMs, schedulerStats.criticalPathMs);
+                std::string criticalPath;
+                for (auto index: schedulerStats.criticalPath) {
+                    const auto& name = schedulerStats.systems[index].name;
+                    criticalPath += criticalPath.empty() ? name : " -> " + name;
+                }
+                ImGui::TextWrapped("critical path: %s", criticalPath.c_str());
+                ImGui::Separator();
+                for (const auto& timing: schedulerStats.systems) {
+                    ImGui::Text("%-20s start %.3f ms, took %.3f ms", timing.name.c_str(), timing.startMs, timing.durationMs);
+                }
+            }
+            ImGui::End();
+
+            // Display the memory the systems took from the frame arena in the last frame
+            if (ImGui::Begin("Frame arena")) {
+                ImGui::Text("last frame %zu bytes, peak %zu bytes, capacity %zu bytes", frameArenaStats.frameBytes, frameArenaStats.peakBytes, frameArenaStats.capacity);
+                ImGui::Text("allocations outside the arena: %d", frameArenaStats.numOverflows);
+            }
+            ImGui::End();
+
             ImGui::Render();
             ImGuiSDL::Render(ImGui::GetDrawData());
         }
@@ -7,8 +7,38 @@
 #include "../Components/SpriteComponent.h"
 #include "../Components/HealthComponent.h"
 #include <SDL2/SDL.h>
+#include <cstdio>
+#include <unordered_map>
 
 class RenderHealthBarSystem: public System {
+    private:
+        // Texture of a percentage label, rendered once and shared by every health bar showing it
+        // (freed with the renderer)
+        struct CachedLabel {
+            SDL_Texture* texture;
+            int width;
+            int height;
+        };
+
+        // [Key = health percentage]
+        std::unordered_map<int, CachedLabel> m_cachedLabels;
+
+        const CachedLabel& GetLabel(SDL_Renderer* renderer, const std::unique_ptr<AssetStore>& assetStore, int healthPercentage, SDL_Color color) {
+            auto cachedLabel = m_cachedLabels.find(healthPercentage);
+            if (cachedLabel != m_cachedLabels.end()) {
+                return cachedLabel->second;
+            }
+
+            char healthText[16];
+            std::snprintf(healthText, sizeof(healthText), "%d", healthPercentage);
+            SDL_Surface* surface = TTF_RenderText_Blended(assetStore->GetFont("pico8-font-5"), healthText, color);
+
+            CachedLabel label = { SDL_CreateTextureFromSurface(renderer, surface), 0, 0 };
+            SDL_FreeSurface(surface);
+            SDL_QueryTexture(label.texture, NULL, NULL, &label.width, &label.height);
+            return m_cachedLabels.emplace(healthPercentage, label).first->second;
+        }
+
     public:
         RenderHealthBarSystem() {
             RequireComponent<TransformComponent>();
@@ -16,11 +46,12 @@ class RenderHealthBarSystem: public System {
             RequireComponent<HealthComponent>();
         }
 
+
         void Update(SDL_Renderer* renderer, const std::unique_ptr<AssetStore>& assetStore, const SDL_Rect& camera) {
             for (auto entity: GetSystemEntities()) {
-                const auto transform = entity.GetComponent<TransformComponent>();
-                const auto sprite = entity.GetComponent<SpriteComponent>();
-                const auto health = entity.GetComponent<HealthComponent>();
+                const auto& transform = entity.GetComponent<const TransformComponent>();
+                const auto& sprite = entity.GetComponent<const SpriteComponent>();
+                const auto& health = entity.GetComponent<const HealthComponent>();
 
                 // Draw a the health bar with the correct color for the percentage
                 SDL_Color healthBarColor = {255, 255, 255};
@@ -53,25 +84,16 @@ class RenderHealthBarSystem: public System {
                 SDL_SetRenderDrawColor(renderer, healthBarColor.r, healthBarColor.g, healthBarColor.b, 255);
                 SDL_RenderFillRect(renderer, &healthBarRectangle);
 
-                // Render the health percentage text label indicator
-                std::string healthText = std::to_string(health.healthPercentage);
-                SDL_Surface* surface = TTF_RenderText_Blended(assetStore->GetFont("pico8-font-5"), healthText.c_str(), healthBarColor);
-                SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-                SDL_FreeSurface(surface);
-
-                int labelWidth = 0;
-                int labelHeight = 0;
-                SDL_QueryTexture(texture, NULL, NULL, &labelWidth, &labelHeight);
+                // Render the health percentage text label indicator, the color only depends on the percentage
+                const auto& label = GetLabel(renderer, assetStore, health.healthPercentage, healthBarColor);
                 SDL_Rect healthBarTextRectangle = {
                     static_cast<int>(healthBarPosX),
                     static_cast<int>(healthBarPosY) + 5,
-                    labelWidth,
-                    labelHeight
+                    label.width,
+                    label.height
                 };
                 
-                SDL_RenderCopy(renderer, texture, NULL, &healthBarTextRectangle);
-
-                SDL_DestroyTexture(texture);
+                SDL_RenderCopy(renderer, label.texture, NULL, &healthBarTextRectangle);
             }
         }
 };
@@ -86,7 +86,7 @@ void ShowAssets(std::unique_ptr<ImGui::FileBrowser>& m_fileDialog, std::unique_p
         static std::string selectedAssetId;
         {
             ImGui::BeginChild("Assets List", ImVec2(150, 0), true);
-            std::map<std::string, SDL_Texture*> textures = m_assetStore->GetAllTextures();
+            const auto& textures = m_assetStore->GetAllTextures();
             
             for (auto it = ++textures.begin(); it != textures.end(); ++it)
             {
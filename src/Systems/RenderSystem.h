@@ -6,57 +6,57 @@
 #include "../Components/TransformComponent.h"
 #include <SDL2/SDL.h>
 #include "../AssetStore/AssetStore.h"
+#include "../Memory/FrameArena.h"
 #include <algorithm>
 
 
 class RenderSystem: public System {
+    private:
+        struct RenderableEntity {
+            const TransformComponent* transformComponent;
+            const SpriteComponent* spriteComponent;
+        };
+
     public:
         RenderSystem() {
             RequireComponent<TransformComponent>();
             RequireComponent<SpriteComponent>();
         }
 
-        void Update(SDL_Renderer* renderer, std::unique_ptr<AssetStore>& assetStore, SDL_Rect& camera) {
-
-            // THIS SORTING CAN BE POLISHED, RIGHT NOW CAN BE PERFORMATIC SORT ALL ENTITIES ON EACH FRAME------------------------------------
-            // Create a vector copy with both sprite and transform components
-            struct RenderableEntity {
-                TransformComponent transformComponent;
-                SpriteComponent spriteComponent;
-            };
-
-            std::vector<RenderableEntity> renderableEntities;
+        void Update(SDL_Renderer* renderer, std::unique_ptr<Registry>& registry, std::unique_ptr<AssetStore>& assetStore, SDL_Rect& camera, FrameArena& frameArena) {
 
-            for (auto entity: GetSystemEntities()) {
-                RenderableEntity re;
-                re.spriteComponent = entity.GetComponent<SpriteComponent>();
-                re.transformComponent = entity.GetComponent<TransformComponent>();
+            // Collect pointers to the visible sprite and transform components, straight from the pools
+            // of the Transform/Sprite owning group (side by side arrays, see Game::Setup).
+            // The list only lives for this frame, it is taken from the frame arena.
+            FrameVector<RenderableEntity> renderableEntities(frameArena);
+            renderableEntities.reserve(GetSystemEntities().size());
 
+            registry->GetOwningGroup<const TransformComponent, const SpriteComponent>().Each([&](Entity entity, const TransformComponent& transform, const SpriteComponent& sprite) {
                 // Bypass rendering entitites if they are outside the cameraview (culling)
                 bool isEntityOutsideCameraView = (
-                    re.transformComponent.position.x + (re.transformComponent.scale.x * re.spriteComponent.width) < camera.x ||
-                    re.transformComponent.position.x > camera.x + camera.w ||
-                    re.transformComponent.position.y + ((re.transformComponent.scale.y * re.spriteComponent.height)) < camera.y ||
-                    re.transformComponent.position.y > camera.y + camera.h
+                    transform.position.x + (transform.scale.x * sprite.width) < camera.x ||
+                    transform.position.x > camera.x + camera.w ||
+                    transform.position.y + ((transform.scale.y * sprite.height)) < camera.y ||
+                    transform.position.y > camera.y + camera.h
                 );
 
                 // Culling sprites outside camera view and not fixed
-                if (isEntityOutsideCameraView && !re.spriteComponent.isFixed) {
-                    continue;
+                if (isEntityOutsideCameraView && !sprite.isFixed) {
+                    return;
                 }
-                renderableEntities.emplace_back(re);
-            }
+                renderableEntities.push_back({ &transform, &sprite });
+            });
 
-            // Sort the copied vector by z-index
+            // Sort the visible entities by z-index
             std::sort(renderableEntities.begin(), renderableEntities.end(), [](const RenderableEntity& a, const RenderableEntity& b) {
-                return a.spriteComponent.zIndex < b.spriteComponent.zIndex;
+                return a.spriteComponent->zIndex < b.spriteComponent->zIndex;
             });
             
 
             // Loop all entities that the system is interested in.. based on the sorted vector
-            for (auto entity: renderableEntities) {
-                const auto transform = entity.transformComponent;
-                const auto sprite = entity.spriteComponent;
+            for (const auto& entity: renderableEntities) {
+                const auto& transform = *entity.transformComponent;
+                const auto& sprite = *entity.spriteComponent;
 
                 // Set the source rectangle of our origial sprite texture
                 SDL_Rect srcRect = sprite.srcRect;
@@ -5,48 +5,83 @@
 #include "../ECS/ECS.h"
 #include "../Components/TextLabelComponent.h"
 #include <SDL2/SDL.h>
+#include <unordered_map>
 
 class RenderTextSystem: public System {
+    private:
+        // Texture of a label, rendered again only when its TextLabelComponent changes
+        struct CachedLabel {
+            SDL_Texture* texture;
+            int width;
+            int height;
+        };
+
+        // [Key = entity id]
+        std::unordered_map<int, CachedLabel> m_cachedLabels;
+
+        // Tick of the last update, the labels written after it must be rendered again
+        unsigned int m_lastChangeTick = 0;
+
+        void DestroyCachedLabel(int entityId) {
+            auto cachedLabel = m_cachedLabels.find(entityId);
+            if (cachedLabel != m_cachedLabels.end()) {
+                SDL_DestroyTexture(cachedLabel->second.texture);
+                m_cachedLabels.erase(cachedLabel);
+            }
+        }
+
     public:
         RenderTextSystem() {
             RequireComponent<TextLabelComponent>();
         }
 
-        void Update(SDL_Renderer* renderer, std::unique_ptr<AssetStore>& assetStore, const SDL_Rect& camera) {
-            for (auto entity: GetSystemEntities()) {
-                const auto textlabel = entity.GetComponent<TextLabelComponent>();
-                
+        // Frees the texture of a label when its component is removed or its entity killed
+        void ObserveTextLabels(std::unique_ptr<Registry>& registry) {
+            registry->OnComponentRemoved<TextLabelComponent>([this](Entity entity) {
+                DestroyCachedLabel(entity.GetId());
+            });
+        }
+
+        void Update(SDL_Renderer* renderer, std::unique_ptr<Registry>& registry, std::unique_ptr<AssetStore>& assetStore, const SDL_Rect& camera) {
+            // Render the text of the labels added or written since the last frame only
+            const auto sinceTick = m_lastChangeTick;
+            m_lastChangeTick = registry->AdvanceChangeTick();
+
+            registry->View<const TextLabelComponent>().EachChanged<TextLabelComponent>(sinceTick, [&](Entity entity, const TextLabelComponent& textlabel) {
+                DestroyCachedLabel(entity.GetId());
+
                 TTF_Font* font = assetStore->GetFont(textlabel.assetId);
-                
+
                 SDL_Surface* surface = TTF_RenderText_Blended(
                     font,
                     textlabel.text.c_str(),
                     textlabel.color
                 );
-                
 
-                SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+                CachedLabel cachedLabel = { SDL_CreateTextureFromSurface(renderer, surface), 0, 0 };
                 SDL_FreeSurface(surface);
-                
 
-                int labelWidth = 0;
-                int labelHeight = 0;
+                SDL_QueryTexture(cachedLabel.texture, NULL, NULL, &cachedLabel.width, &cachedLabel.height);
+                m_cachedLabels.emplace(entity.GetId(), cachedLabel);
+            });
 
-                SDL_QueryTexture(texture, NULL, NULL, &labelWidth, &labelHeight);
+            for (auto entity: GetSystemEntities()) {
+                auto cachedLabel = m_cachedLabels.find(entity.GetId());
+                if (cachedLabel == m_cachedLabels.end()) {
+                    continue;
+                }
+                const auto& textlabel = entity.GetComponent<const TextLabelComponent>();
 
                 SDL_Rect dstRect = {
                     static_cast<int>(textlabel.position.x - (textlabel.isFixed ? 0 : camera.x)),
                     static_cast<int>(textlabel.position.y - (textlabel.isFixed ? 0 : camera.y)),
-                    labelWidth,
-                    labelHeight
+                    cachedLabel->second.width,
+                    cachedLabel->second.height
                 };
 
-                SDL_RenderCopy(renderer, texture, NULL, &dstRect);
-
-                SDL_DestroyTexture(texture);
-            
+                SDL_RenderCopy(renderer, cachedLabel->second.texture, NULL, &dstRect);
             }
         }
 };
 
-#endif
\ No newline at end of file
+#endif
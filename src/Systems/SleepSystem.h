@@ -0,0 +1,310 @@
+#ifndef SLEEPSYSTEM_H
+#define SLEEPSYSTEM_H
+
+#include "../ECS/ECS.h"
+#include "../Components/TransformComponent.h"
+#include <SDL2/SDL.h>
+#include <unordered_map>
+#include <vector>
+#include <cmath>
+
+// Puts the entities of some groups (ex: enemies) to sleep when they are far outside the camera, and
+// wakes them up when the camera gets close again. Sleeping entities keep their components but leave
+// every system and view (see Entity::SetActive), so most of a large map costs nothing per frame.
+// Both the awake and the sleeping entities wait in grids of cells around their position. A frame only
+// looks closer at the entities added or whose transform changed since the last one (see
+// Registry::AdvanceChangeTick), at the awake cells the sleep area of the camera left, and at the
+// sleeping cells around the camera.
+// The components written while an entity sleeps are seen changed when it wakes up, the Registry
+// stamps them again.
+class SleepSystem: public System {
+    private:
+        // Groups of the entities allowed to sleep, the other entities always stay active
+        std::vector<GroupId> m_sleepingGroups;
+
+        // Entities fall asleep past m_sleepDistance pixels from the camera and wake up within
+        // m_wakeDistance, the gap keeps an entity on the border from switching every frame
+        float m_wakeDistance = 256.0;
+        float m_sleepDistance = 512.0;
+
+        static constexpr int CELL_SIZE = 256;
+
+        // Sleeping entities per grid cell, the killed ones are dropped when their cell is woken up
+        // [Key = cell x and y packed in 64 bits]
+        std::unordered_map<long long, std::vector<Entity>> m_sleepingPerCell;
+
+        // Awake entities allowed to sleep per grid cell, all of them were inside the sleep area
+        // of the camera the last time they were looked at. The cells are never erased.
+        // [Key = cell x and y packed in 64 bits]
+        std::unordered_map<long long, std::vector<Entity>> m_awakePerCell;
+
+        // Where an entity sits in m_awakePerCell, index is -1 when no entity of this id is there
+        // [Vector index = entity id]
+        struct AwakeSlot {
+            long long cellKey = 0;
+            int index = -1;
+            // Of the entity in the grid, the id may have been reused since
+            unsigned int generation = 0;
+        };
+        std::vector<AwakeSlot> m_awakeSlots;
+
+        // Tick of the last update, the transforms written after it are looked at again
+        unsigned int m_lastChangeTick = 0;
+
+        // Entities that got a transform since the last update, they join the system after it
+        // (at the next Registry::Update) with a change tick that is not newer than m_lastChangeTick
+        std::vector<Entity> m_addedEntities;
+
+        // Camera of the last update, the awake entities were all inside its sleep area
+        SDL_Rect m_lastCamera = { 0, 0, 0, 0 };
+        bool m_hasLastCamera = false;
+
+        // Awake entities to check against the sleep area in this update
+        std::vector<Entity> m_candidates;
+
+        static int GetCell(float position) {
+            return static_cast<int>(std::floor(position / CELL_SIZE));
+        }
+
+        static long long GetCellKey(int cellX, int cellY) {
+            return static_cast<long long>((static_cast<unsigned long long>(static_cast<unsigned int>(cellX)) << 32) | static_cast<unsigned int>(cellY));
+        }
+
+        bool MaySleep(Entity entity) const {
+            for (GroupId group: m_sleepingGroups) {
+                if (entity.BelongsToGroup(group)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        static bool IsInside(const glm::vec2& position, const SDL_Rect& camera, float distance) {
+            return position.x >= camera.x - distance && position.x <= camera.x + camera.w + distance &&
+                   position.y >= camera.y - distance && position.y <= camera.y + camera.h + distance;
+        }
+
+        bool IsInAwakeGrid(Entity entity) const {
+            const int entityId = entity.GetId();
+            return entityId < static_cast<int>(m_awakeSlots.size()) && m_awakeSlots[entityId].index != -1 && m_awakeSlots[entityId].generation == entity.GetGeneration();
+        }
+
+        // Removes whatever entity with this id sits in the awake grid
+        void RemoveFromAwakeGrid(int entityId) {
+            if (entityId >= static_cast<int>(m_awakeSlots.size()) || m_awakeSlots[entityId].index == -1) {
+                return;
+            }
+            auto& slot = m_awakeSlots[entityId];
+            // Empty cells are kept, entities moving back and forth over a border do not allocate
+            auto& entities = m_awakePerCell[slot.cellKey];
+            entities[slot.index] = entities.back();
+            m_awakeSlots[entities[slot.index].GetId()].index = slot.index;
+            entities.pop_back();
+            // Updated last, in case the entity was also the last one of the cell
+            slot.index = -1;
+        }
+
+        // Puts the entity in the cell of its position, replacing an older (killed) entity of the same id
+        void PlaceInAwakeGrid(Entity entity, const glm::vec2& position) {
+            const int entityId = entity.GetId();
+            if (entityId >= static_cast<int>(m_awakeSlots.size())) {
+                m_awakeSlots.resize(entityId + 1);
+            }
+            RemoveFromAwakeGrid(entityId);
+            const long long cellKey = GetCellKey(GetCell(position.x), GetCell(position.y));
+            auto& entities = m_awakePerCell[cellKey];
+            m_awakeSlots[entityId] = { cellKey, static_cast<int>(entities.size()), entity.GetGeneration() };
+            entities.push_back(entity);
+        }
+
+        // Follows an added or moved entity in the awake grid, it is a candidate to sleep when it left the sleep area
+        void TrackChanged(Entity entity, const SDL_Rect& camera) {
+            const bool isTracked = IsInAwakeGrid(entity);
+            if (!isTracked && !MaySleep(entity)) {
+                return;
+            }
+            const auto& position = entity.GetComponent<const TransformComponent>().position;
+            // Most moves stay in the same cell
+            if (!isTracked || m_awakeSlots[entity.GetId()].cellKey != GetCellKey(GetCell(position.x), GetCell(position.y))) {
+                PlaceInAwakeGrid(entity, position);
+            }
+            if (!IsInside(position, camera, m_sleepDistance)) {
+                m_candidates.push_back(entity);
+            }
+        }
+
+        // Adds to the candidates the awake entities of the cells that were inside the sleep area
+        // of the last camera but are not entirely inside the one of the new camera
+        void AddCandidatesLeftBehind(const SDL_Rect& camera) {
+            const float left = camera.x - m_sleepDistance;
+            const float top = camera.y - m_sleepDistance;
+            const float right = camera.x + camera.w + m_sleepDistance;
+            const float bottom = camera.y + camera.h + m_sleepDistance;
+
+            const auto& last = m_lastCamera;
+            for (int cellY = GetCell(last.y - m_sleepDistance); cellY <= GetCell(last.y + last.h + m_sleepDistance); cellY++) {
+                for (int cellX = GetCell(last.x - m_sleepDistance); cellX <= GetCell(last.x + last.w + m_sleepDistance); cellX++) {
+                    const bool isCellInside = cellX * CELL_SIZE >= left && (cellX + 1) * CELL_SIZE <= right &&
+                                              cellY * CELL_SIZE >= top && (cellY + 1) * CELL_SIZE <= bottom;
+                    if (isCellInside) {
+                        continue;
+                    }
+                    auto cell = m_awakePerCell.find(GetCellKey(cellX, cellY));
+                    if (cell != m_awakePerCell.end()) {
+                        m_candidates.insert(m_candidates.end(), cell->second.begin(), cell->second.end());
+                    }
+                }
+            }
+        }
+
+        void SleepIfFar(std::unique_ptr<Registry>& registry, Entity entity, const SDL_Rect& camera) {
+            // Already put to sleep by this update, or replaced in the grid by a newer entity of its id
+            if (!IsInAwakeGrid(entity)) {
+                return;
+            }
+            // Killed, or put to sleep by someone else
+            if (!registry->IsActive(entity) || !entity.HasComponent<TransformComponent>()) {
+                RemoveFromAwakeGrid(entity.GetId());
+                return;
+            }
+            const auto& position = entity.GetComponent<const TransformComponent>().position;
+            if (IsInside(position, camera, m_sleepDistance)) {
+                return;
+            }
+            RemoveFromAwakeGrid(entity.GetId());
+            entity.SetActive(false);
+            m_sleepingPerCell[GetCellKey(GetCell(position.x), GetCell(position.y))].push_back(entity);
+        }
+
+    public:
+        SleepSystem() {
+            RequireComponent<TransformComponent>();
+        }
+
+        // Sleeping groups and distances are set before the entities are created
+        void AddSleepingGroup(const std::string& group) {
+            m_sleepingGroups.push_back(Registry::GetGroupId(group));
+        }
+
+        void SetDistances(float wakeDistance, float sleepDistance) {
+            m_wakeDistance = wakeDistance;
+            m_sleepDistance = std::max(sleepDistance, wakeDistance);
+        }
+
+        // Finds the new entities, to call once before they are created
+        void ObserveTransforms(std::unique_ptr<Registry>& registry) {
+            registry->OnComponentAdded<TransformComponent>([this](Entity entity) {
+                m_addedEntities.push_back(entity);
+            });
+        }
+
+        int GetNumSleeping() const {
+            int numSleeping = 0;
+            for (const auto& cell: m_sleepingPerCell) {
+                numSleeping += static_cast<int>(cell.second.size());
+            }
+            return numSleeping;
+        }
+
+        // Rebuilds the grids from the entities of the registry, after its entities were
+        // replaced (ex: a Snapshot was loaded)
+        void Reset(std::unique_ptr<Registry>& registry) {
+            m_sleepingPerCell.clear();
+            m_awakePerCell.clear();
+            m_awakeSlots.clear();
+            m_addedEntities.clear();
+            m_hasLastCamera = false;
+            for (GroupId group: m_sleepingGroups) {
+                for (auto entity: registry->GetEntitiesByGroup(group)) {
+                    if (!entity.HasComponent<TransformComponent>()) {
+                        continue;
+                    }
+                    // The awake ones are looked at by the next update
+                    if (registry->IsActive(entity)) {
+                        m_addedEntities.push_back(entity);
+                        continue;
+                    }
+                    const auto& position = entity.GetComponent<const TransformComponent>().position;
+                    m_sleepingPerCell[GetCellKey(GetCell(position.x), GetCell(position.y))].push_back(entity);
+                }
+            }
+        }
+
+        // Must run on the main thread after the camera moved, the changes are applied by the next Registry::Update()
+        void Update(std::unique_ptr<Registry>& registry, const SDL_Rect& camera) {
+            const auto sinceTick = m_lastChangeTick;
+            m_lastChangeTick = registry->AdvanceChangeTick();
+
+            // The entities that were added or moved may have left the sleep area or changed cell.
+            // The awake entities are the ones of the system, a view would walk the sleeping ones too.
+            m_candidates.clear();
+            for (auto entity: m_addedEntities) {
+                if (registry->IsActive(entity) && entity.HasComponent<TransformComponent>()) {
+                    TrackChanged(entity, camera);
+                }
+            }
+            m_addedEntities.clear();
+            for (auto entity: GetSystemEntities()) {
+                if (registry->GetComponentChangeTick<TransformComponent>(entity) > sinceTick) {
+                    TrackChanged(entity, camera);
+                }
+            }
+
+            // The ones that did not move may have been left behind by the camera
+            const bool hasCameraMoved = m_lastCamera.x != camera.x || m_lastCamera.y != camera.y ||
+                                        m_lastCamera.w != camera.w || m_lastCamera.h != camera.h;
+            if (m_hasLastCamera && hasCameraMoved) {
+                AddCandidatesLeftBehind(camera);
+            }
+            m_lastCamera = camera;
+            m_hasLastCamera = true;
+
+            // Put to sleep the entities that are too far away
+            for (auto entity: m_candidates) {
+                SleepIfFar(registry, entity, camera);
+            }
+
+            // Wake up the sleeping entities of the cells around the camera
+            const float left = camera.x - m_wakeDistance;
+            const float top = camera.y - m_wakeDistance;
+            const float right = camera.x + camera.w + m_wakeDistance;
+            const float bottom = camera.y + camera.h + m_wakeDistance;
+            for (int cellY = GetCell(top); cellY <= GetCell(bottom); cellY++) {
+                for (int cellX = GetCell(left); cellX <= GetCell(right); cellX++) {
+                    auto cell = m_sleepingPerCell.find(GetCellKey(cellX, cellY));
+                    if (cell == m_sleepingPerCell.end()) {
+                        continue;
+                    }
+
+                    auto& sleepers = cell->second;
+                    for (size_t i = 0; i < sleepers.size();) {
+                        Entity entity = sleepers[i];
+                        // Killed while asleep, or its transform was removed
+                        bool hasLeftGrid = !registry->IsAlive(entity) || !entity.HasComponent<TransformComponent>();
+                        if (!hasLeftGrid) {
+                            const auto& position = entity.GetComponent<const TransformComponent>().position;
+                            // Woken up by someone else, or by us. It joins the system again at the next
+                            // Registry::Update(), its transform is looked at when it changes.
+                            if (registry->IsActive(entity) || IsInside(position, camera, m_wakeDistance)) {
+                                entity.SetActive(true);
+                                PlaceInAwakeGrid(entity, position);
+                                hasLeftGrid = true;
+                            }
+                        }
+
+                        if (hasLeftGrid) {
+                            sleepers[i] = sleepers.back();
+                            sleepers.pop_back();
+                        } else {
+                            i++;
+                        }
+                    }
+                    if (sleepers.empty()) {
+                        m_sleepingPerCell.erase(cell);
+                    }
+                }
+            }
+        }
+};
+
+#endif